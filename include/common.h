@@ -5,14 +5,12 @@
 #ifndef PROJECT_BASE_COMMON_H
 #define PROJECT_BASE_COMMON_H
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <learnopengl/vfs.h>
 
 std::string readFileContents(std::string path) {
-    std::ifstream in(path);
-    std::stringstream buffer;
-    buffer << in.rdbuf();
-    return buffer.str();
+    FileContents contents;
+    Vfs::get().read(path, contents);
+    return contents.str();
 }
 
 
@@ -0,0 +1,256 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// CPU block compression encoders for the offline texture bake (BC1, BC3, BC4 and BC5).
+// Every encoder works on a 4x4 block of RGBA8 texels (64 bytes, row major) and uses a range fit:
+// the endpoints come from the (slightly inset) per-channel bounds of the block and every texel is
+// projected onto the endpoint axis to pick its palette index. Bounds and projections use SSE2 when available.
+namespace bc {
+
+enum Format {
+    BC1, // RGB, 4 bpp
+    BC3, // RGBA, 8 bpp (BC4 alpha + BC1 color)
+    BC4, // single channel, 4 bpp
+    BC5  // two channels (normal map XY), 8 bpp
+};
+
+inline size_t blockBytes(Format format)
+{
+    return (format == BC1 || format == BC4) ? 8 : 16;
+}
+
+inline size_t levelBytes(Format format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+// per channel minimum and maximum of the 16 texels
+inline void blockBounds(const uint8_t *rgba, uint8_t mn[4], uint8_t mx[4])
+{
+#ifdef __SSE2__
+    __m128i a = _mm_loadu_si128((const __m128i *)(rgba + 0));
+    __m128i b = _mm_loadu_si128((const __m128i *)(rgba + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(rgba + 32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(rgba + 48));
+    __m128i lo = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+    __m128i hi = _mm_max_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    int l = _mm_cvtsi128_si32(lo);
+    int h = _mm_cvtsi128_si32(hi);
+    memcpy(mn, &l, 4);
+    memcpy(mx, &h, 4);
+#else
+    for (int c = 0; c < 4; c++)
+    {
+        mn[c] = 255;
+        mx[c] = 0;
+    }
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+        {
+            mn[c] = std::min(mn[c], rgba[i * 4 + c]);
+            mx[c] = std::max(mx[c], rgba[i * 4 + c]);
+        }
+#endif
+}
+
+// dot product of every texel's RGB with dir
+inline void projectRGB(const uint8_t *rgba, const int dir[3], int dots[16])
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i axis = _mm_setr_epi16((short)dir[0], (short)dir[1], (short)dir[2], 0,
+                                        (short)dir[0], (short)dir[1], (short)dir[2], 0);
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i texels = _mm_loadu_si128((const __m128i *)(rgba + i * 16));
+        __m128i pairs[2] = {_mm_unpacklo_epi8(texels, zero), _mm_unpackhi_epi8(texels, zero)};
+        for (int j = 0; j < 2; j++)
+        {
+            // (r*dr + g*dg, b*db) per texel, then fold the two halves together
+            __m128i m = _mm_madd_epi16(pairs[j], axis);
+            m = _mm_add_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+            int lanes[4];
+            _mm_storeu_si128((__m128i *)lanes, m);
+            dots[i * 4 + j * 2 + 0] = lanes[0];
+            dots[i * 4 + j * 2 + 1] = lanes[2];
+        }
+    }
+#else
+    for (int i = 0; i < 16; i++)
+        dots[i] = rgba[i * 4 + 0] * dir[0] + rgba[i * 4 + 1] * dir[1] + rgba[i * 4 + 2] * dir[2];
+#endif
+}
+
+inline uint16_t packRGB565(int r, int g, int b)
+{
+    return (uint16_t)((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+inline void unpackRGB565(uint16_t color, int rgb[3])
+{
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+inline void encodeBC1(const uint8_t *rgba, uint8_t *out)
+{
+    uint8_t mn[4], mx[4];
+    blockBounds(rgba, mn, mx);
+    // inset the bounding box by 1/16 of its size, the extremes are rarely worth an endpoint
+    int hi[3], lo[3];
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (mx[c] - mn[c]) >> 4;
+        hi[c] = mx[c] - inset;
+        lo[c] = mn[c] + inset;
+    }
+    uint16_t c0 = packRGB565(hi[0], hi[1], hi[2]);
+    uint16_t c1 = packRGB565(lo[0], lo[1], lo[2]);
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        // c0 > c1 always holds here (hi >= lo per channel), which selects the four color mode
+        int p0[3], p1[3], dir[3];
+        unpackRGB565(c0, p0);
+        unpackRGB565(c1, p1);
+        for (int c = 0; c < 3; c++)
+            dir[c] = p0[c] - p1[c];
+        int dots[16];
+        projectRGB(rgba, dir, dots);
+        int d1 = p1[0] * dir[0] + p1[1] * dir[1] + p1[2] * dir[2];
+        int range = p0[0] * dir[0] + p0[1] * dir[1] + p0[2] * dir[2] - d1;
+        // position along c1 -> c0 in thirds, mapped to the BC1 palette order (c0, c1, 2/3 c0, 1/3 c0)
+        static const uint32_t remap[4] = {1, 3, 2, 0};
+        for (int i = 0; i < 16; i++)
+        {
+            int t = ((dots[i] - d1) * 6 + range) / (2 * range);
+            t = std::min(3, std::max(0, t));
+            indices |= remap[t] << (2 * i);
+        }
+    }
+    out[0] = (uint8_t)(c0 & 0xff);
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)(c1 & 0xff);
+    out[3] = (uint8_t)(c1 >> 8);
+    memcpy(out + 4, &indices, 4);
+}
+
+// single channel block (BC4, and the halves of BC3 alpha / BC5)
+inline void encodeBC4(const uint8_t *rgba, int channel, uint8_t *out)
+{
+    uint8_t mn[4], mx[4];
+    blockBounds(rgba, mn, mx);
+    int a0 = mx[channel], a1 = mn[channel];
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        // a0 > a1 selects the eight value mode; position 0..7 from a0 to a1 maps to index 0, 2..7, 1
+        int range = a0 - a1;
+        for (int i = 0; i < 16; i++)
+        {
+            int t = ((a0 - rgba[i * 4 + channel]) * 14 + range) / (2 * range);
+            uint64_t index = t == 0 ? 0 : (t == 7 ? 1 : (uint64_t)t + 1);
+            indices |= index << (3 * i);
+        }
+    }
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+inline void encodeBlock(const uint8_t *rgba, Format format, uint8_t *out)
+{
+    switch (format)
+    {
+        case BC1:
+            encodeBC1(rgba, out);
+            break;
+        case BC3:
+            encodeBC4(rgba, 3, out);
+            encodeBC1(rgba, out + 8);
+            break;
+        case BC4:
+            encodeBC4(rgba, 0, out);
+            break;
+        case BC5:
+            encodeBC4(rgba, 0, out);
+            encodeBC4(rgba, 1, out + 8);
+            break;
+    }
+}
+
+// encodes block rows [firstRow, lastRow) of an RGBA8 image into out, which holds levelBytes(format, width, height)
+inline void encodeRows(const uint8_t *rgba, int width, int height, Format format, int firstRow, int lastRow, uint8_t *out)
+{
+    int blocksX = (width + 3) / 4;
+    size_t stride = blockBytes(format);
+    uint8_t block[64];
+    for (int by = firstRow; by < lastRow; by++)
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            // gather the block, clamping at the right and bottom edge of small mip levels
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++)
+                {
+                    int sx = std::min(bx * 4 + x, width - 1);
+                    int sy = std::min(by * 4 + y, height - 1);
+                    memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+                }
+            encodeBlock(block, format, out + ((size_t)by * blocksX + bx) * stride);
+        }
+}
+
+// 2x2 box filter to the next mip level. Normal maps are renormalized so the mips keep unit length normals.
+inline std::vector<uint8_t> downsample(const std::vector<uint8_t> &rgba, int width, int height, bool normalMap)
+{
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    std::vector<uint8_t> result((size_t)w * h * 4);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            int sum[4] = {0, 0, 0, 0};
+            for (int dy = 0; dy < 2; dy++)
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    int sx = std::min(x * 2 + dx, width - 1);
+                    int sy = std::min(y * 2 + dy, height - 1);
+                    const uint8_t *texel = &rgba[((size_t)sy * width + sx) * 4];
+                    for (int c = 0; c < 4; c++)
+                        sum[c] += texel[c];
+                }
+            uint8_t *dst = &result[((size_t)y * w + x) * 4];
+            for (int c = 0; c < 4; c++)
+                dst[c] = (uint8_t)((sum[c] + 2) / 4);
+            if (normalMap)
+            {
+                float n[3];
+                for (int c = 0; c < 3; c++)
+                    n[c] = sum[c] / (4.0f * 127.5f) - 1.0f;
+                float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (length > 0.0f)
+                    for (int c = 0; c < 3; c++)
+                        dst[c] = (uint8_t)std::min(255.0f, std::max(0.0f, (n[c] / length + 1.0f) * 127.5f + 0.5f));
+            }
+        }
+    return result;
+}
+
+}
+#endif
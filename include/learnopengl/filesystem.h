@@ -3,6 +3,9 @@
 
 #include <string>
 #include <cstdlib>
+#include <cerrno>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include "root_directory.h" // This is a configuration file generated by CMake.
 
 class FileSystem
@@ -17,6 +20,19 @@ public:
     return (*pathBuilder)(path);
   }
 
+  // creates path and any missing parent directories, like mkdir -p
+  static bool createDirectories(const std::string& path)
+  {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+    {
+      std::string prefix = path.substr(0, slash);
+      if (!prefix.empty() && mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+      if (slash == std::string::npos)
+        return true;
+    }
+  }
+
 private:
   static std::string const & getRoot()
   {
@@ -0,0 +1,228 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Shadow copy of the GL state the render loop changes: program, VAO, active unit and texture bindings,
+// capabilities, cull face, depth function and mask, blend function and framebuffer. Each setter compares with
+// the copy and drops the call when nothing would change. Code that binds through raw GL calls makes the copy
+// stale: call invalidate() after it (the render loop does once per frame, after uploads and hot reloads).
+enum GLStateCall {
+    GL_STATE_PROGRAM,
+    GL_STATE_VERTEX_ARRAY,
+    GL_STATE_ACTIVE_TEXTURE,
+    GL_STATE_TEXTURE,
+    GL_STATE_CAPABILITY,
+    GL_STATE_CULL_FACE,
+    GL_STATE_DEPTH_FUNC,
+    GL_STATE_DEPTH_MASK,
+    GL_STATE_BLEND_FUNC,
+    GL_STATE_FRAMEBUFFER,
+    GL_STATE_CALL_COUNT
+};
+
+// GL calls issued and dropped per kind, since the last resetStats
+struct GLStateStats {
+    size_t issued[GL_STATE_CALL_COUNT] = {};
+    size_t filtered[GL_STATE_CALL_COUNT] = {};
+
+    size_t totalIssued() const
+    {
+        size_t total = 0;
+        for (size_t count : issued)
+            total += count;
+        return total;
+    }
+    size_t totalFiltered() const
+    {
+        size_t total = 0;
+        for (size_t count : filtered)
+            total += count;
+        return total;
+    }
+    static const char *name(GLStateCall call)
+    {
+        static const char *const names[GL_STATE_CALL_COUNT] = {"program", "vertex array", "active texture", "texture", "capability",
+                                                               "cull face", "depth func", "depth mask", "blend func", "framebuffer"};
+        return names[call];
+    }
+};
+
+const unsigned int GL_STATE_TEXTURE_UNITS = 16;
+
+class GLState
+{
+public:
+    static GLState &get()
+    {
+        static GLState state;
+        return state;
+    }
+
+    // forgets the copy, the next call of every kind goes to GL
+    void invalidate()
+    {
+        program = vertexArray = activeUnit = UNKNOWN;
+        for (unsigned int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+            texture2D[unit] = textureCube[unit] = UNKNOWN;
+        for (Capability &capability : capabilities)
+            capability.enabled = -1;
+        cullMode = depthFunction = blendSource = blendDestination = UNKNOWN;
+        depthWrites = -1;
+        drawFramebuffer = readFramebuffer = UNKNOWN;
+    }
+
+    void useProgram(GLuint id)
+    {
+        if (skip(program, id, GL_STATE_PROGRAM))
+            return;
+        glUseProgram(id);
+    }
+
+    void bindVertexArray(GLuint id)
+    {
+        if (skip(vertexArray, id, GL_STATE_VERTEX_ARRAY))
+            return;
+        glBindVertexArray(id);
+    }
+
+    // unit is the index, not GL_TEXTUREi
+    void activeTexture(unsigned int unit)
+    {
+        if (skip(activeUnit, unit, GL_STATE_ACTIVE_TEXTURE))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // binds id to target on unit, selecting the unit only when the binding changes. Targets other than
+    // GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP, and units past GL_STATE_TEXTURE_UNITS, always go to GL.
+    void bindTexture(unsigned int unit, GLenum target, GLuint id)
+    {
+        GLuint *binding = nullptr;
+        if (unit < GL_STATE_TEXTURE_UNITS)
+            binding = target == GL_TEXTURE_2D ? &texture2D[unit] : target == GL_TEXTURE_CUBE_MAP ? &textureCube[unit] : nullptr;
+        if (binding && skip(*binding, id, GL_STATE_TEXTURE))
+            return;
+        if (!binding)
+            stats.issued[GL_STATE_TEXTURE]++;
+        activeTexture(unit);
+        glBindTexture(target, id);
+    }
+
+    void setCapability(GLenum cap, bool enabled)
+    {
+        Capability *capability = nullptr;
+        for (Capability &known : capabilities)
+            if (known.cap == cap)
+                capability = &known;
+        if (capability && capability->enabled == (enabled ? 1 : 0))
+        {
+            stats.filtered[GL_STATE_CAPABILITY]++;
+            return;
+        }
+        stats.issued[GL_STATE_CAPABILITY]++;
+        if (capability)
+            capability->enabled = enabled ? 1 : 0;
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+    void enable(GLenum cap) { setCapability(cap, true); }
+    void disable(GLenum cap) { setCapability(cap, false); }
+
+    void cullFace(GLenum mode)
+    {
+        if (skip(cullMode, mode, GL_STATE_CULL_FACE))
+            return;
+        glCullFace(mode);
+    }
+
+    void depthFunc(GLenum func)
+    {
+        if (skip(depthFunction, func, GL_STATE_DEPTH_FUNC))
+            return;
+        glDepthFunc(func);
+    }
+
+    void depthMask(bool writes)
+    {
+        if (depthWrites == (writes ? 1 : 0))
+        {
+            stats.filtered[GL_STATE_DEPTH_MASK]++;
+            return;
+        }
+        stats.issued[GL_STATE_DEPTH_MASK]++;
+        depthWrites = writes ? 1 : 0;
+        glDepthMask(writes ? GL_TRUE : GL_FALSE);
+    }
+
+    void blendFunc(GLenum source, GLenum destination)
+    {
+        if (blendSource == source && blendDestination == destination)
+        {
+            stats.filtered[GL_STATE_BLEND_FUNC]++;
+            return;
+        }
+        stats.issued[GL_STATE_BLEND_FUNC]++;
+        blendSource = source;
+        blendDestination = destination;
+        glBlendFunc(source, destination);
+    }
+
+    // GL_FRAMEBUFFER sets both the draw and the read binding
+    void bindFramebuffer(GLenum target, GLuint id)
+    {
+        bool draw = target != GL_READ_FRAMEBUFFER, read = target != GL_DRAW_FRAMEBUFFER;
+        if ((!draw || drawFramebuffer == id) && (!read || readFramebuffer == id))
+        {
+            stats.filtered[GL_STATE_FRAMEBUFFER]++;
+            return;
+        }
+        stats.issued[GL_STATE_FRAMEBUFFER]++;
+        if (draw)
+            drawFramebuffer = id;
+        if (read)
+            readFramebuffer = id;
+        glBindFramebuffer(target, id);
+    }
+
+    const GLStateStats &getStats() const { return stats; }
+    void resetStats() { stats = GLStateStats(); }
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+
+    struct Capability {
+        GLenum cap;
+        int enabled; // -1 unknown
+    };
+
+    GLuint program, vertexArray, activeUnit;
+    GLuint texture2D[GL_STATE_TEXTURE_UNITS], textureCube[GL_STATE_TEXTURE_UNITS];
+    Capability capabilities[4] = {{GL_CULL_FACE, -1}, {GL_DEPTH_TEST, -1}, {GL_BLEND, -1}, {GL_MULTISAMPLE, -1}};
+    GLuint cullMode, depthFunction, blendSource, blendDestination;
+    int depthWrites;
+    GLuint drawFramebuffer, readFramebuffer;
+    GLStateStats stats;
+
+    GLState()
+    {
+        invalidate();
+    }
+
+    bool skip(GLuint &current, GLuint value, GLStateCall call)
+    {
+        if (current == value)
+        {
+            stats.filtered[call]++;
+            return true;
+        }
+        stats.issued[call]++;
+        current = value;
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,477 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/json.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/vfs.h>
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Binary glTF (.glb) and glTF with external .bin buffers, loaded without converting a single vertex.
+//
+// GltfAsset::load runs on any thread: it maps the file and its buffers (or takes them from the mounted archive),
+// reads the JSON and describes every triangle primitive as vertex attributes and an index range straight from
+// the accessors: component type, count, normalization, stride and offset. It also touches the used pages so the
+// GL thread doesn't wait on the disk. upload() then copies each used buffer view from the mapping into a GL
+// buffer with glBufferSubData, and the Meshes point their VAOs into those buffers (disk -> page cache -> GPU).
+//
+// Attributes: POSITION (0), NORMAL (1), TEXCOORD_0 (2), TANGENT (3, with the handedness in w like
+// VERTEX_FORMAT_PACKED, there is no bitangent). Materials: baseColorTexture as texture_diffuse, normalTexture
+// as texture_normal, images given by URI. Like the Assimp path, node transforms are not applied.
+// Anything this path can't draw in place (data URIs, sparse accessors, non-indexed or non-triangle primitives)
+// makes load() fail, and Model::import falls back to Assimp.
+
+const uint32_t GLB_MAGIC       = 0x46546c67; // "glTF"
+const uint32_t GLB_CHUNK_JSON  = 0x4e4f534a; // "JSON"
+const uint32_t GLB_CHUNK_BIN   = 0x004e4942; // "BIN\0"
+
+struct GltfPrimitive {
+    vector<VertexAttribute> attributes; // buffer is an index into GltfAsset::buffers until upload()
+    unsigned int indexBuffer;
+    size_t indexOffset;
+    unsigned int indexCount;
+    GLenum indexType;
+    glm::vec3 boundsMin, boundsMax;
+    vector<CachedTexture> textures;
+};
+
+class GltfAsset
+{
+public:
+    vector<GltfPrimitive> primitives;
+
+    static bool isGltf(const string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == string::npos)
+            return false;
+        string extension = path.substr(dot);
+        return strcasecmp(extension.c_str(), ".glb") == 0 || strcasecmp(extension.c_str(), ".gltf") == 0;
+    }
+
+    // false with error set if the file is not valid glTF or uses something that can't be drawn in place
+    bool load(const string &path, string &error)
+    {
+        if (!file.open(path))
+            return fail(error, "could not read " + path);
+        directory = path.substr(0, path.find_last_of('/') + 1);
+
+        // binary container: header, JSON chunk, optional BIN chunk
+        const char *jsonText = (const char *)file.data;
+        size_t jsonLength = file.size;
+        const unsigned char *bin = nullptr;
+        size_t binLength = 0;
+        uint32_t header[3];
+        if (file.size >= sizeof(header))
+            memcpy(header, file.data, sizeof(header));
+        if (file.size >= sizeof(header) && header[0] == GLB_MAGIC)
+        {
+            if (header[1] != 2 || header[2] > file.size)
+                return fail(error, "unsupported GLB version or truncated file");
+            size_t offset = sizeof(header);
+            jsonText = nullptr;
+            while (offset + 8 <= header[2])
+            {
+                uint32_t chunk[2];
+                memcpy(chunk, file.data + offset, sizeof(chunk));
+                offset += 8;
+                if (chunk[0] > header[2] - offset)
+                    return fail(error, "truncated GLB chunk");
+                if (chunk[1] == GLB_CHUNK_JSON && !jsonText)
+                {
+                    jsonText = (const char *)file.data + offset;
+                    jsonLength = chunk[0];
+                }
+                else if (chunk[1] == GLB_CHUNK_BIN && !bin)
+                {
+                    bin = file.data + offset;
+                    binLength = chunk[0];
+                }
+                offset += (chunk[0] + 3) & ~3u;
+            }
+            if (!jsonText)
+                return fail(error, "GLB without JSON chunk");
+        }
+
+        JsonValue json;
+        string jsonError;
+        if (!JsonValue::parse(jsonText, jsonLength, json, jsonError))
+            return fail(error, "invalid JSON: " + jsonError);
+        if (json["asset"]["version"].asString().compare(0, 2, "2.") != 0)
+            return fail(error, "not glTF 2.0");
+
+        return loadBuffers(json, bin, binLength, error) && loadViews(json, error) && loadPrimitives(json, error);
+    }
+
+    // creates the GL buffers with the used buffer views and points the primitives at them; GL thread only.
+    // Returns the buffers, which the caller owns (Model::Release deletes them).
+    vector<unsigned int> upload()
+    {
+        vector<unsigned int> ids(buffers.size(), 0);
+        for (size_t b = 0; b < buffers.size(); b++)
+        {
+            if (buffers[b].uploadSize == 0)
+                continue;
+            glGenBuffers(1, &ids[b]);
+            glBindBuffer(GL_ARRAY_BUFFER, ids[b]);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)buffers[b].uploadSize, nullptr, GL_STATIC_DRAW);
+        }
+        for (const View &view : views)
+            if (view.used)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, ids[view.buffer]);
+                glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)view.uploadOffset, (GLsizeiptr)view.length, view.data);
+            }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (GltfPrimitive &primitive : primitives)
+        {
+            for (VertexAttribute &attribute : primitive.attributes)
+                attribute.buffer = ids[attribute.buffer];
+            primitive.indexBuffer = ids[primitive.indexBuffer];
+        }
+        // the data is on the GPU, the mappings can go
+        for (Buffer &buffer : buffers)
+            buffer.file.close();
+        file.close();
+        ids.erase(std::remove(ids.begin(), ids.end(), 0u), ids.end());
+        return ids;
+    }
+
+private:
+    struct Buffer {
+        MappedFile file;          // external buffer; the GLB BIN chunk lives in GltfAsset::file
+        const unsigned char *data = nullptr;
+        size_t length = 0;
+        size_t uploadSize = 0;    // bytes of the used views in the GL buffer
+    };
+
+    struct View {
+        size_t buffer = 0;
+        const unsigned char *data = nullptr;
+        size_t length = 0;
+        size_t stride = 0;
+        bool used = false;
+        size_t uploadOffset = 0;  // in the GL buffer
+    };
+
+    MappedFile file;
+    string directory;
+    vector<Buffer> buffers;
+    vector<View> views;
+    // buffer view of every attribute and index range, in primitive order
+    vector<size_t> viewOfAttribute, viewOfIndices;
+
+    static bool fail(string &error, const string &message)
+    {
+        error = message;
+        return false;
+    }
+
+    // "%20" and friends in URIs
+    static string decodeUri(const string &uri)
+    {
+        string decoded;
+        for (size_t i = 0; i < uri.size(); i++)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+            {
+                decoded += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+                i += 2;
+            }
+            else
+                decoded += uri[i];
+        }
+        return decoded;
+    }
+
+    bool loadBuffers(const JsonValue &json, const unsigned char *bin, size_t binLength, string &error)
+    {
+        const JsonValue &list = json["buffers"];
+        buffers.resize(list.size());
+        for (size_t b = 0; b < list.size(); b++)
+        {
+            Buffer &buffer = buffers[b];
+            buffer.length = (size_t)list[b]["byteLength"].asInt(-1);
+            const JsonValue &uri = list[b]["uri"];
+            if (uri.isNull())
+            {
+                if (b != 0 || !bin)
+                    return fail(error, "buffer without URI outside a GLB");
+                buffer.data = bin;
+                if (buffer.length > binLength)
+                    return fail(error, "BIN chunk shorter than its buffer");
+                continue;
+            }
+            if (uri.asString().compare(0, 5, "data:") == 0)
+                return fail(error, "embedded (data URI) buffers are not read in place");
+            if (!buffer.file.open(directory + decodeUri(uri.asString())))
+                return fail(error, "could not read buffer " + uri.asString());
+            buffer.data = buffer.file.data;
+            if (buffer.length > buffer.file.size)
+                return fail(error, "buffer file shorter than its byteLength");
+        }
+        return true;
+    }
+
+    bool loadViews(const JsonValue &json, string &error)
+    {
+        const JsonValue &list = json["bufferViews"];
+        views.resize(list.size());
+        for (size_t v = 0; v < list.size(); v++)
+        {
+            View &view = views[v];
+            long long buffer = list[v]["buffer"].asInt(-1);
+            size_t offset = (size_t)list[v]["byteOffset"].asInt(0);
+            view.length = (size_t)list[v]["byteLength"].asInt(0);
+            view.stride = (size_t)list[v]["byteStride"].asInt(0);
+            if (buffer < 0 || (size_t)buffer >= buffers.size() || offset + view.length > buffers[buffer].length)
+                return fail(error, "buffer view out of range");
+            view.buffer = (size_t)buffer;
+            view.data = buffers[buffer].data + offset;
+        }
+        return true;
+    }
+
+    static size_t componentSize(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+        case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+        default: return 0;
+        }
+    }
+
+    static int componentCount(const string &type)
+    {
+        if (type == "SCALAR")
+            return 1;
+        if (type.size() == 4 && type.compare(0, 3, "VEC") == 0 && type[3] >= '2' && type[3] <= '4')
+            return type[3] - '0';
+        return 0;
+    }
+
+    // accessor as a range of a buffer view; marks the view for upload
+    struct Accessor {
+        size_t view;
+        size_t offset; // into the view
+        GLenum type;
+        int components;
+        GLboolean normalized;
+        size_t count;
+        size_t stride;
+    };
+
+    bool accessor(const JsonValue &json, long long index, Accessor &result, string &error)
+    {
+        const JsonValue &a = json["accessors"][(size_t)std::max(index, -1LL)];
+        if (!a.isObject())
+            return fail(error, "missing accessor");
+        if (!a["sparse"].isNull())
+            return fail(error, "sparse accessors are not read in place");
+        long long view = a["bufferView"].asInt(-1);
+        if (view < 0 || (size_t)view >= views.size())
+            return fail(error, "accessor without buffer view");
+        result.view = (size_t)view;
+        result.offset = (size_t)a["byteOffset"].asInt(0);
+        result.type = (GLenum)a["componentType"].asInt(0);
+        result.components = componentCount(a["type"].asString());
+        result.normalized = a["normalized"].asBool() ? GL_TRUE : GL_FALSE;
+        result.count = (size_t)a["count"].asInt(0);
+        size_t elementSize = componentSize(result.type) * (size_t)result.components;
+        if (elementSize == 0 || result.count == 0)
+            return fail(error, "unsupported accessor type");
+        result.stride = views[result.view].stride ? views[result.view].stride : elementSize;
+        if (result.offset + result.stride * (result.count - 1) + elementSize > views[result.view].length)
+            return fail(error, "accessor out of range");
+        views[result.view].used = true;
+        return true;
+    }
+
+    // bounds of a POSITION accessor: min/max from the file (required by the spec), else scanned
+    bool positionBounds(const JsonValue &json, long long index, const Accessor &positions, glm::vec3 &lo, glm::vec3 &hi)
+    {
+        const JsonValue &a = json["accessors"][(size_t)index];
+        if (a["min"].size() >= 3 && a["max"].size() >= 3)
+        {
+            float scale = 1.0f;
+            if (positions.normalized)
+                scale = positions.type == GL_BYTE ? 1.0f / 127.0f : positions.type == GL_UNSIGNED_BYTE ? 1.0f / 255.0f
+                      : positions.type == GL_SHORT ? 1.0f / 32767.0f : positions.type == GL_UNSIGNED_SHORT ? 1.0f / 65535.0f : 1.0f;
+            for (int c = 0; c < 3; c++)
+            {
+                lo[c] = (float)a["min"][(size_t)c].asNumber() * scale;
+                hi[c] = (float)a["max"][(size_t)c].asNumber() * scale;
+            }
+            return true;
+        }
+        if (positions.type != GL_FLOAT || positions.components != 3)
+            return false;
+        lo = glm::vec3(FLT_MAX);
+        hi = glm::vec3(-FLT_MAX);
+        const unsigned char *p = views[positions.view].data + positions.offset;
+        for (size_t i = 0; i < positions.count; i++, p += positions.stride)
+        {
+            glm::vec3 v;
+            memcpy(&v.x, p, sizeof(float) * 3);
+            lo = glm::min(lo, v);
+            hi = glm::max(hi, v);
+        }
+        return true;
+    }
+
+    vector<CachedTexture> materialTextures(const JsonValue &json, long long materialIndex)
+    {
+        vector<CachedTexture> textures;
+        if (materialIndex < 0)
+            return textures;
+        const JsonValue &material = json["materials"][(size_t)materialIndex];
+        const JsonValue *slots[2] = {&material["pbrMetallicRoughness"]["baseColorTexture"], &material["normalTexture"]};
+        const char *types[2] = {"texture_diffuse", "texture_normal"};
+        for (int s = 0; s < 2; s++)
+        {
+            long long texture = (*slots[s])["index"].asInt(-1);
+            if (texture < 0)
+                continue;
+            long long source = json["textures"][(size_t)texture]["source"].asInt(-1);
+            const JsonValue &uri = json["images"][(size_t)std::max(source, 0LL)]["uri"];
+            if (source < 0 || !uri.isString() || uri.asString().compare(0, 5, "data:") == 0)
+            {
+                cout << "WARNING::GLTF:: embedded image of material " << materialIndex << " is not loaded" << endl;
+                continue;
+            }
+            textures.push_back(CachedTexture{types[s], decodeUri(uri.asString())});
+        }
+        return textures;
+    }
+
+    static void collectMeshes(const JsonValue &json, long long node, vector<long long> &meshes, int depth)
+    {
+        const JsonValue &n = json["nodes"][(size_t)std::max(node, 0LL)];
+        if (node < 0 || !n.isObject() || depth > 64)
+            return;
+        if (!n["mesh"].isNull())
+            meshes.push_back(n["mesh"].asInt(-1));
+        for (size_t c = 0; c < n["children"].size(); c++)
+            collectMeshes(json, n["children"][c].asInt(-1), meshes, depth + 1);
+    }
+
+    bool loadPrimitives(const JsonValue &json, string &error)
+    {
+        // meshes in node order of the default scene, like Model::processNode; all meshes without a scene
+        vector<long long> meshes;
+        const JsonValue &scene = json["scenes"][(size_t)json["scene"].asInt(0)];
+        if (scene.isObject())
+            for (size_t n = 0; n < scene["nodes"].size(); n++)
+                collectMeshes(json, scene["nodes"][n].asInt(-1), meshes, 0);
+        else
+            for (size_t m = 0; m < json["meshes"].size(); m++)
+                meshes.push_back((long long)m);
+
+        static const char *const attributeNames[4] = {"POSITION", "NORMAL", "TEXCOORD_0", "TANGENT"};
+        for (long long m : meshes)
+        {
+            const JsonValue &list = json["meshes"][(size_t)std::max(m, 0LL)]["primitives"];
+            if (m < 0 || list.size() == 0)
+                return fail(error, "node refers to a missing mesh");
+            for (size_t p = 0; p < list.size(); p++)
+            {
+                const JsonValue &source = list[p];
+                if (source["mode"].asInt(4) != 4)
+                    return fail(error, "only triangle lists are drawn in place");
+                if (source["indices"].isNull())
+                    return fail(error, "non-indexed primitives are not drawn in place");
+
+                GltfPrimitive primitive;
+                long long positionIndex = -1;
+                Accessor positions = Accessor();
+                for (GLuint location = 0; location < 4; location++)
+                {
+                    const JsonValue &index = source["attributes"][attributeNames[location]];
+                    if (index.isNull())
+                    {
+                        if (location == 0)
+                            return fail(error, "primitive without positions");
+                        continue;
+                    }
+                    Accessor a;
+                    if (!accessor(json, index.asInt(-1), a, error))
+                        return false;
+                    if (location == 0)
+                    {
+                        positionIndex = index.asInt(-1);
+                        positions = a;
+                    }
+                    // offset within the view for now, the views are placed in the GL buffers below
+                    primitive.attributes.push_back(VertexAttribute{location, a.components, a.type, a.normalized, (GLsizei)a.stride,
+                                                                   a.offset, (unsigned int)views[a.view].buffer});
+                    viewOfAttribute.push_back(a.view);
+                }
+
+                Accessor indices;
+                if (!accessor(json, source["indices"].asInt(-1), indices, error))
+                    return false;
+                if (indices.components != 1 || (indices.type != GL_UNSIGNED_BYTE && indices.type != GL_UNSIGNED_SHORT && indices.type != GL_UNSIGNED_INT) ||
+                    indices.stride != componentSize(indices.type))
+                    return fail(error, "invalid index accessor");
+                primitive.indexBuffer = (unsigned int)views[indices.view].buffer;
+                primitive.indexOffset = indices.offset;
+                primitive.indexCount = (unsigned int)indices.count;
+                primitive.indexType = indices.type;
+                viewOfIndices.push_back(indices.view);
+
+                if (!positionBounds(json, positionIndex, positions, primitive.boundsMin, primitive.boundsMax))
+                    return fail(error, "positions without bounds");
+                primitive.textures = materialTextures(json, source["material"].asInt(-1));
+                primitives.push_back(std::move(primitive));
+            }
+        }
+        if (primitives.empty())
+            return fail(error, "no meshes");
+
+        // place the used views in their GL buffers, then rebase the offsets of attributes and indices
+        for (View &view : views)
+            if (view.used)
+            {
+                Buffer &buffer = buffers[view.buffer];
+                view.uploadOffset = (buffer.uploadSize + 15) & ~(size_t)15;
+                buffer.uploadSize = view.uploadOffset + view.length;
+            }
+        size_t attribute = 0;
+        for (size_t p = 0; p < primitives.size(); p++)
+        {
+            for (VertexAttribute &a : primitives[p].attributes)
+                a.offset += views[viewOfAttribute[attribute++]].uploadOffset;
+            primitives[p].indexOffset += views[viewOfIndices[p]].uploadOffset;
+        }
+
+        // fault the used pages in here (a worker thread) so upload() on the GL thread reads from the page cache
+        volatile unsigned char sink = 0;
+        for (const View &view : views)
+            if (view.used)
+                for (size_t offset = 0; offset < view.length; offset += 4096)
+                    sink = sink + view.data[offset];
+        (void)sink;
+        return true;
+    }
+};
+#endif
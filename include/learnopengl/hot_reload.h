@@ -0,0 +1,319 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/vfs.h>
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Recursive inotify watch over a directory tree. poll() never blocks and returns the files that were
+// written (closed after writing) or moved in, which covers editors that save through a temporary file.
+class FileWatcher
+{
+public:
+    FileWatcher() {}
+    ~FileWatcher() { stop(); }
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    bool start(const string &directory)
+    {
+        stop();
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            return false;
+        addDirectory(directory);
+        return !directories.empty();
+    }
+
+    void stop()
+    {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+        directories.clear();
+    }
+
+    void poll(vector<string> &changed)
+    {
+        if (fd < 0)
+            return;
+        alignas(inotify_event) char buffer[16 * 1024];
+        for (;;)
+        {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                return;
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const inotify_event *event = (const inotify_event *)(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                auto directory = directories.find(event->wd);
+                if (directory == directories.end() || event->len == 0)
+                    continue;
+                string path = directory->second + "/" + event->name;
+                if (event->mask & IN_ISDIR)
+                {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                        addDirectory(path);
+                }
+                else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    changed.push_back(path);
+            }
+        }
+    }
+
+private:
+    int fd = -1;
+    unordered_map<int, string> directories;
+
+    void addDirectory(const string &path)
+    {
+        int wd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0)
+            return;
+        directories[wd] = path;
+        DIR *dir = opendir(path.c_str());
+        if (!dir)
+            return;
+        while (dirent *entry = readdir(dir))
+        {
+            string name = entry->d_name;
+            if (entry->d_type == DT_DIR && name != "." && name != "..")
+                addDirectory(path + "/" + name);
+        }
+        closedir(dir);
+    }
+};
+
+// Reloads changed shaders, textures and models while the program runs.
+//
+// update() is called once per frame between frames on the GL thread. Changes are debounced (an editor saving
+// a file produces several events) and then:
+// - shaders are recompiled and swapped in if they link (Shader::reload)
+// - textures are re-read and decoded in the background, the TextureRegistry swaps the GL texture once uploaded
+// - models are imported again on the thread pool; the new model replaces the old one between frames
+// GL work is spread over frames: a new reload only starts while the frame's budget is not used up, and a
+// single reload that alone takes longer than the budget is reported.
+class HotReloader
+{
+public:
+    explicit HotReloader(double frameBudgetMs = 2.0, double settleMs = 100.0)
+        : frameBudgetMs(frameBudgetMs), settleMs(settleMs) {}
+
+    bool start(const string &directory)
+    {
+        bool started = watcher.start(directory);
+        if (started)
+            cout << "Hot reload: watching " << directory << endl;
+        return started;
+    }
+
+    void watch(Shader &shader)
+    {
+        shaders.push_back(&shader);
+    }
+
+    // the model is reloaded when its file or a .mtl or .bin (glTF buffer) next to it changes
+    void watch(Model &model)
+    {
+        shared_ptr<WatchedModel> watched = make_shared<WatchedModel>();
+        watched->model = &model;
+        models.push_back(watched);
+    }
+
+    void update()
+    {
+        auto frameStart = chrono::steady_clock::now();
+        auto now = frameStart;
+
+        vector<string> changed;
+        watcher.poll(changed);
+        for (const string &path : changed)
+            settling[Vfs::get().relativeName(path)] = Settling{path, now};
+
+        // a file is handled once no new event came in for settleMs
+        for (auto it = settling.begin(); it != settling.end();)
+        {
+            if (chrono::duration<double, milli>(now - it->second.lastEvent).count() >= settleMs)
+            {
+                ready.push_back(it->second.path);
+                it = settling.erase(it);
+            }
+            else
+                ++it;
+        }
+
+        // imported models waiting to be swapped in, then new changes, as long as the frame budget lasts
+        while (elapsedMs(frameStart) < frameBudgetMs)
+        {
+            if (swapImportedModel())
+                continue;
+            if (ready.empty())
+                break;
+            string path = ready.front();
+            ready.erase(ready.begin());
+            auto start = chrono::steady_clock::now();
+            handle(path);
+            double ms = elapsedMs(start);
+            if (ms > frameBudgetMs)
+                cout << "Hot reload: " << Vfs::get().relativeName(path) << " took " << ms << " ms (frame budget " << frameBudgetMs << " ms)" << endl;
+        }
+    }
+
+private:
+    struct Settling {
+        string path;
+        chrono::steady_clock::time_point lastEvent;
+    };
+
+    // shared with the import job, which may still run when the reloader goes away
+    struct WatchedModel {
+        Model *model = nullptr;
+        bool importing = false;
+        bool changedAgain = false; // changed while importing, import once more afterwards
+        bool imported = false;
+        bool readCache = true;
+        ModelData data;
+        mutex dataMutex;
+    };
+
+    FileWatcher watcher;
+    double frameBudgetMs;
+    double settleMs;
+    map<string, Settling> settling;
+    vector<string> ready;
+    vector<Shader *> shaders;
+    vector<shared_ptr<WatchedModel>> models;
+
+    static double elapsedMs(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    static string extension(const string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of('/');
+        if (dot == string::npos || (slash != string::npos && dot < slash))
+            return "";
+        return path.substr(dot);
+    }
+
+    static string directoryOf(const string &name)
+    {
+        size_t slash = name.find_last_of('/');
+        return slash == string::npos ? "" : name.substr(0, slash);
+    }
+
+    void handle(const string &path)
+    {
+        Vfs &vfs = Vfs::get();
+        // the archive holds the old contents, and the old baked texture if path is an image
+        vfs.overrideWithLooseFile(path);
+        vfs.overrideWithLooseFile(bakedTexturePath(path));
+        string name = vfs.relativeName(path);
+
+        for (Shader *shader : shaders)
+            if (vfs.relativeName(shader->getVertexPath()) == name || vfs.relativeName(shader->getFragmentPath()) == name ||
+                (!shader->getGeometryPath().empty() && vfs.relativeName(shader->getGeometryPath()) == name))
+            {
+                if (shader->reload())
+                    cout << "Hot reload: shader " << name << endl;
+                else
+                    cout << "Hot reload: " << name << " failed to compile, keeping the previous program" << endl;
+            }
+
+        if (size_t textures = TextureRegistry::get().reload(path))
+            cout << "Hot reload: texture " << name << " (" << textures << ")" << endl;
+
+        bool material = extension(name) == ".mtl" || extension(name) == ".bin";
+        for (const shared_ptr<WatchedModel> &watched : models)
+        {
+            string modelName = vfs.relativeName(watched->model->path);
+            if (modelName == name || (material && directoryOf(modelName) == directoryOf(name)))
+            {
+                // a packed mesh cache is never checked against the source, a loose one against the model file only
+                vfs.overrideWithLooseFile(MeshCache::cacheFileFor(watched->model->path));
+                if (material)
+                    watched->readCache = false;
+                import(watched);
+            }
+        }
+    }
+
+    void import(const shared_ptr<WatchedModel> &watched)
+    {
+        if (watched->importing)
+        {
+            watched->changedAgain = true;
+            return;
+        }
+        watched->importing = true;
+        string path = watched->model->path;
+        ModelOptions options = watched->model->options;
+        bool readCache = watched->readCache;
+        watched->readCache = true;
+        ThreadPool::shared().enqueue([watched, path, options, readCache] {
+            ModelData data = Model::import(path, options, readCache);
+            lock_guard<mutex> lock(watched->dataMutex);
+            watched->data = std::move(data);
+            watched->imported = true;
+        });
+    }
+
+    // creates the GL objects of one finished import and swaps the model in; returns false if none is ready
+    bool swapImportedModel()
+    {
+        for (const shared_ptr<WatchedModel> &watched : models)
+        {
+            ModelData data;
+            {
+                lock_guard<mutex> lock(watched->dataMutex);
+                if (!watched->imported)
+                    continue;
+                data = std::move(watched->data);
+                watched->imported = false;
+            }
+            watched->importing = false;
+
+            auto start = chrono::steady_clock::now();
+            string name = Vfs::get().relativeName(data.path);
+            if (data.valid)
+            {
+                Model fresh(data, watched->model->gammaCorrection);
+                watched->model->Replace(std::move(fresh));
+                cout << "Hot reload: model " << name << " in " << elapsedMs(start) << " ms" << endl;
+            }
+            else
+                cout << "Hot reload: " << name << " failed to import, keeping the previous model" << endl;
+            if (elapsedMs(start) > frameBudgetMs)
+                cout << "Hot reload: swapping " << name << " took " << elapsedMs(start) << " ms (frame budget " << frameBudgetMs << " ms)" << endl;
+
+            if (watched->changedAgain)
+            {
+                watched->changedAgain = false;
+                import(watched);
+            }
+            return true;
+        }
+        return false;
+    }
+};
+#endif
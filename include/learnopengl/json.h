@@ -0,0 +1,336 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Small JSON reader for asset descriptions (glTF). Parses a whole document into a tree of JsonValues;
+// lookups of missing members or out of range elements return a null value, so chains like
+// json["accessors"][2]["bufferView"].asInt(-1) need no checks in between.
+class JsonValue
+{
+public:
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = NUL;
+
+    bool isNull() const { return type == NUL; }
+    bool isNumber() const { return type == NUMBER; }
+    bool isString() const { return type == STRING; }
+    bool isArray() const { return type == ARRAY; }
+    bool isObject() const { return type == OBJECT; }
+
+    double asNumber(double fallback = 0.0) const
+    {
+        return type == NUMBER ? number : fallback;
+    }
+
+    long long asInt(long long fallback = 0) const
+    {
+        return type == NUMBER ? (long long)number : fallback;
+    }
+
+    bool asBool(bool fallback = false) const
+    {
+        return type == BOOLEAN ? boolean : fallback;
+    }
+
+    const string &asString() const
+    {
+        return text;
+    }
+
+    // elements of an array, members of an object
+    size_t size() const
+    {
+        return type == ARRAY ? elements.size() : type == OBJECT ? members.size() : 0;
+    }
+
+    const JsonValue &operator[](size_t index) const
+    {
+        return type == ARRAY && index < elements.size() ? elements[index] : null();
+    }
+
+    const JsonValue &operator[](const char *key) const
+    {
+        if (type == OBJECT)
+            for (const auto &member : members)
+                if (member.first == key)
+                    return member.second;
+        return null();
+    }
+
+    const vector<pair<string, JsonValue>> &objectMembers() const
+    {
+        return members;
+    }
+
+    // parses text; false and error set if it isn't valid JSON
+    static bool parse(const char *text, size_t length, JsonValue &value, string &error)
+    {
+        Parser parser{text, text + length, ""};
+        value = JsonValue();
+        parser.skipSpace();
+        if (!parser.parseValue(value, 0))
+        {
+            error = parser.error;
+            return false;
+        }
+        parser.skipSpace();
+        if (parser.p != parser.end)
+        {
+            error = "trailing characters";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    double number = 0.0;
+    bool boolean = false;
+    string text;
+    vector<JsonValue> elements;
+    vector<pair<string, JsonValue>> members;
+
+    static const JsonValue &null()
+    {
+        static const JsonValue value;
+        return value;
+    }
+
+    struct Parser {
+        const char *p;
+        const char *end;
+        string error;
+
+        bool fail(const char *message)
+        {
+            error = message;
+            return false;
+        }
+
+        void skipSpace()
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                p++;
+        }
+
+        bool literal(const char *word)
+        {
+            size_t length = strlen(word);
+            if ((size_t)(end - p) < length || memcmp(p, word, length) != 0)
+                return fail("invalid literal");
+            p += length;
+            return true;
+        }
+
+        static void appendUtf8(string &out, unsigned int code)
+        {
+            if (code < 0x80)
+                out += (char)code;
+            else if (code < 0x800)
+            {
+                out += (char)(0xc0 | (code >> 6));
+                out += (char)(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                out += (char)(0xe0 | (code >> 12));
+                out += (char)(0x80 | ((code >> 6) & 0x3f));
+                out += (char)(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                out += (char)(0xf0 | (code >> 18));
+                out += (char)(0x80 | ((code >> 12) & 0x3f));
+                out += (char)(0x80 | ((code >> 6) & 0x3f));
+                out += (char)(0x80 | (code & 0x3f));
+            }
+        }
+
+        bool hex4(unsigned int &code)
+        {
+            if (end - p < 4)
+                return fail("truncated escape");
+            code = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char c = *p++;
+                code <<= 4;
+                if (c >= '0' && c <= '9')
+                    code |= (unsigned int)(c - '0');
+                else if (c >= 'a' && c <= 'f')
+                    code |= (unsigned int)(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F')
+                    code |= (unsigned int)(c - 'A' + 10);
+                else
+                    return fail("invalid escape");
+            }
+            return true;
+        }
+
+        bool parseString(string &out)
+        {
+            p++; // opening quote
+            while (p < end && *p != '"')
+            {
+                if (*p != '\\')
+                {
+                    out += *p++;
+                    continue;
+                }
+                if (++p >= end)
+                    break;
+                char c = *p++;
+                switch (c)
+                {
+                case '"': case '\\': case '/': out += c; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u':
+                {
+                    unsigned int code;
+                    if (!hex4(code))
+                        return false;
+                    // surrogate pair
+                    if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                    {
+                        p += 2;
+                        unsigned int low;
+                        if (!hex4(low))
+                            return false;
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+                }
+            }
+            if (p >= end)
+                return fail("unterminated string");
+            p++; // closing quote
+            return true;
+        }
+
+        bool parseValue(JsonValue &value, int depth)
+        {
+            if (depth > 256)
+                return fail("nesting too deep");
+            if (p >= end)
+                return fail("unexpected end");
+            switch (*p)
+            {
+            case '{':
+            {
+                value.type = OBJECT;
+                p++;
+                skipSpace();
+                if (p < end && *p == '}')
+                {
+                    p++;
+                    return true;
+                }
+                for (;;)
+                {
+                    skipSpace();
+                    if (p >= end || *p != '"')
+                        return fail("expected member name");
+                    value.members.push_back(make_pair(string(), JsonValue()));
+                    if (!parseString(value.members.back().first))
+                        return false;
+                    skipSpace();
+                    if (p >= end || *p != ':')
+                        return fail("expected ':'");
+                    p++;
+                    skipSpace();
+                    if (!parseValue(value.members.back().second, depth + 1))
+                        return false;
+                    skipSpace();
+                    if (p < end && *p == ',')
+                    {
+                        p++;
+                        continue;
+                    }
+                    if (p < end && *p == '}')
+                    {
+                        p++;
+                        return true;
+                    }
+                    return fail("expected ',' or '}'");
+                }
+            }
+            case '[':
+            {
+                value.type = ARRAY;
+                p++;
+                skipSpace();
+                if (p < end && *p == ']')
+                {
+                    p++;
+                    return true;
+                }
+                for (;;)
+                {
+                    skipSpace();
+                    value.elements.push_back(JsonValue());
+                    if (!parseValue(value.elements.back(), depth + 1))
+                        return false;
+                    skipSpace();
+                    if (p < end && *p == ',')
+                    {
+                        p++;
+                        continue;
+                    }
+                    if (p < end && *p == ']')
+                    {
+                        p++;
+                        return true;
+                    }
+                    return fail("expected ',' or ']'");
+                }
+            }
+            case '"':
+                value.type = STRING;
+                return parseString(value.text);
+            case 't':
+                value.type = BOOLEAN;
+                value.boolean = true;
+                return literal("true");
+            case 'f':
+                value.type = BOOLEAN;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default:
+            {
+                // strtod needs a terminated string, numbers are short
+                char buffer[64];
+                size_t length = 0;
+                while (p + length < end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", p[length]))
+                    length++;
+                if (length == 0)
+                    return fail("unexpected character");
+                memcpy(buffer, p, length);
+                buffer[length] = 0;
+                char *after;
+                value.type = NUMBER;
+                value.number = strtod(buffer, &after);
+                if (after == buffer)
+                    return fail("invalid number");
+                p += after - buffer;
+                return true;
+            }
+            }
+        }
+    };
+};
+#endif
@@ -0,0 +1,169 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <learnopengl/bc_encoder.h>
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Minimal KTX 1.1 container for the baked (block compressed) textures: a single 2D image with a full
+// mip chain and no key/value data. Baked files sit next to their source image with a .ktx extension.
+
+// internal formats used by the bake step
+const uint32_t KTX_COMPRESSED_RGB_S3TC_DXT1  = 0x83F0; // BC1
+const uint32_t KTX_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3; // BC3
+const uint32_t KTX_COMPRESSED_RED_RGTC1      = 0x8DBB; // BC4
+const uint32_t KTX_COMPRESSED_RG_RGTC2       = 0x8DBD; // BC5
+
+// largest width or height parseKtx accepts
+const uint32_t KTX_MAX_DIMENSION = 65536;
+
+const unsigned char KTX_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct KtxHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+struct KtxLevel {
+    uint32_t width;
+    uint32_t height;
+    size_t   offset; // from the start of the file
+    size_t   size;
+};
+
+struct KtxImage {
+    uint32_t internalFormat;
+    vector<KtxLevel> levels;
+};
+
+// path of the baked counterpart of a source image, e.g. textures/marble.jpg -> textures/marble.ktx
+string bakedTexturePath(const string &sourcePath)
+{
+    size_t dot = sourcePath.find_last_of('.');
+    size_t slash = sourcePath.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return sourcePath + ".ktx";
+    return sourcePath.substr(0, dot) + ".ktx";
+}
+
+// true if a baked file exists and is not older than its source image
+bool bakedTextureIsCurrent(const string &sourcePath)
+{
+    struct stat baked, source;
+    if (stat(bakedTexturePath(sourcePath).c_str(), &baked) != 0)
+        return false;
+    if (stat(sourcePath.c_str(), &source) != 0)
+        return true; // only the baked file was shipped
+    return baked.st_mtime >= source.st_mtime;
+}
+
+bool writeKtx(const string &path, uint32_t internalFormat, uint32_t baseFormat, uint32_t width, uint32_t height,
+              const vector<vector<uint8_t>> &levels)
+{
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out)
+        return false;
+    KtxHeader header;
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = 0x04030201;
+    header.glType = 0;
+    header.glTypeSize = 1;
+    header.glFormat = 0;
+    header.glInternalFormat = internalFormat;
+    header.glBaseInternalFormat = baseFormat;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = (uint32_t)levels.size();
+    header.bytesOfKeyValueData = 0;
+    out.write((const char *)&header, sizeof(header));
+    for (const vector<uint8_t> &level : levels)
+    {
+        uint32_t imageSize = (uint32_t)level.size();
+        out.write((const char *)&imageSize, sizeof(imageSize));
+        out.write((const char *)level.data(), level.size());
+        static const char zeros[4] = {0};
+        out.write(zeros, (4 - level.size() % 4) % 4); // mip padding
+    }
+    return (bool)out;
+}
+
+// block format of one of the internal formats above; false for anything else
+bool ktxBlockFormat(uint32_t internalFormat, bc::Format &format)
+{
+    switch (internalFormat)
+    {
+    case KTX_COMPRESSED_RGB_S3TC_DXT1:  format = bc::BC1; return true;
+    case KTX_COMPRESSED_RGBA_S3TC_DXT5: format = bc::BC3; return true;
+    case KTX_COMPRESSED_RED_RGTC1:      format = bc::BC4; return true;
+    case KTX_COMPRESSED_RG_RGTC2:       format = bc::BC5; return true;
+    }
+    return false;
+}
+
+// parses the level table of a KTX file in memory; level offsets point into data. Only files the bake step
+// could have written pass: one of its formats, a non-empty image and levels of exactly the block compressed
+// size of their dimensions, so the loader can trust the table when it uploads or streams the levels.
+bool parseKtx(const unsigned char *data, size_t size, KtxImage &image)
+{
+    KtxHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != 0x04030201 ||
+        header.glType != 0 || header.numberOfFaces != 1 || header.numberOfArrayElements != 0)
+        return false;
+    bc::Format format;
+    if (!ktxBlockFormat(header.glInternalFormat, format) || header.pixelWidth == 0 || header.pixelHeight == 0 ||
+        header.pixelWidth > KTX_MAX_DIMENSION || header.pixelHeight > KTX_MAX_DIMENSION)
+        return false;
+
+    image.internalFormat = header.glInternalFormat;
+    image.levels.clear();
+    size_t offset = sizeof(header) + header.bytesOfKeyValueData;
+    uint32_t width = header.pixelWidth, height = header.pixelHeight;
+    uint32_t levelCount = header.numberOfMipmapLevels ? header.numberOfMipmapLevels : 1;
+    uint32_t fullChain = 1;
+    for (uint32_t extent = std::max(width, height); extent > 1; extent /= 2)
+        fullChain++;
+    if (levelCount > fullChain)
+        return false;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        uint32_t imageSize;
+        if (offset + sizeof(imageSize) > size)
+            return false;
+        memcpy(&imageSize, data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+        if (imageSize != bc::levelBytes(format, (int)width, (int)height) || offset + imageSize > size)
+            return false;
+        KtxLevel level = {width, height, offset, imageSize};
+        image.levels.push_back(level);
+        offset += imageSize + (4 - imageSize % 4) % 4;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return true;
+}
+#endif
@@ -6,8 +6,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/gl_state.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 using namespace std;
@@ -25,12 +31,265 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// GPU side vertex layout of a mesh
+enum VertexFormat {
+    VERTEX_FORMAT_FLOAT, // Vertex as is, 56 bytes
+    VERTEX_FORMAT_PACKED // PackedVertex, 20 bytes
+};
+
+// Compact vertex layout. The vertex shader decodes it with the positionOffset/positionScale uniforms that
+// Mesh::Draw sets (identity for VERTEX_FORMAT_FLOAT, so the same shader handles both layouts):
+//   position = positionOffset + aPos * positionScale
+// The bitangent is not stored, shaders that need it use cross(normal, tangent.xyz) * tangent.w.
+struct PackedVertex {
+    uint16_t Position[4];  // unorm16 against the mesh bounds (w unused)
+    uint32_t Normal;       // GL_INT_2_10_10_10_REV, snorm
+    uint32_t Tangent;      // GL_INT_2_10_10_10_REV, snorm, w = handedness (only its sign is reliable)
+    uint16_t TexCoords[2]; // half floats
+};
+
+// float to IEEE half with round to nearest, overflow goes to infinity and tiny values to (signed) zero
+inline uint16_t packHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (((bits >> 23) & 0xff) == 0xff) // inf / nan
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7c00);
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return (uint16_t)sign;
+        // subnormal half
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) // round, a carry into the exponent is still correct
+        half++;
+    return (uint16_t)half;
+}
+
+// three snorm 10 bit components and a snorm 2 bit w in GL_INT_2_10_10_10_REV order (x in the low bits)
+inline uint32_t packSnorm1010102(float x, float y, float z, float w)
+{
+    auto component = [](float v, float range, uint32_t mask) {
+        v = std::min(1.0f, std::max(-1.0f, v));
+        return (uint32_t)(int32_t)lroundf(v * range) & mask;
+    };
+    return component(x, 511.0f, 0x3ff) | (component(y, 511.0f, 0x3ff) << 10) | (component(z, 511.0f, 0x3ff) << 20) |
+           (component(w, 1.0f, 0x3) << 30);
+}
+
+// bounding sphere and box of a mesh in model space and the decode of its vertex positions. Computed on
+// import and stored in the mesh cache next to the vertices it describes.
+struct MeshBounds {
+    glm::vec3 min, max;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 positionOffset, positionScale; // the box for VERTEX_FORMAT_PACKED, identity for VERTEX_FORMAT_FLOAT
+};
+
+inline MeshBounds computeBounds(const Vertex *vertices, size_t count, VertexFormat format)
+{
+    MeshBounds bounds;
+    glm::vec3 lo(0.0f), hi(0.0f);
+    if (count > 0)
+        lo = hi = vertices[0].Position;
+    for (size_t i = 1; i < count; i++)
+    {
+        lo = glm::min(lo, vertices[i].Position);
+        hi = glm::max(hi, vertices[i].Position);
+    }
+    bounds.min = lo;
+    bounds.max = hi;
+    bounds.center = (lo + hi) * 0.5f;
+    bounds.radius = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        bounds.radius = std::max(bounds.radius, glm::length(vertices[i].Position - bounds.center));
+    bounds.positionOffset = format == VERTEX_FORMAT_PACKED ? lo : glm::vec3(0.0f);
+    bounds.positionScale = format == VERTEX_FORMAT_PACKED ? hi - lo : glm::vec3(1.0f);
+    return bounds;
+}
+
+// packs vertices against the decode parameters of computeBounds (their bounding box)
+inline void packVertices(const Vertex *vertices, size_t count, PackedVertex *packed, const glm::vec3 &offset, const glm::vec3 &scale)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex &v = vertices[i];
+        for (int c = 0; c < 3; c++)
+            packed[i].Position[c] = scale[c] > 0.0f ? (uint16_t)lroundf((v.Position[c] - offset[c]) / scale[c] * 65535.0f) : 0;
+        packed[i].Position[3] = 0;
+        packed[i].Normal = packSnorm1010102(v.Normal.x, v.Normal.y, v.Normal.z, 0.0f);
+        float handedness = glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed[i].Tangent = packSnorm1010102(v.Tangent.x, v.Tangent.y, v.Tangent.z, handedness);
+        packed[i].TexCoords[0] = packHalf(v.TexCoords.x);
+        packed[i].TexCoords[1] = packHalf(v.TexCoords.y);
+    }
+}
+
 
 
 struct Texture {
     unsigned int id;
     string type;
     string path;
+    TextureHandle handle; // keeps the shared texture alive while the mesh uses it
+};
+
+// one level of detail: a range of the mesh's index list (level 0 is the full mesh) and its geometric error
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error; // in model units, see simplifyMesh
+};
+
+// cluster of up to 64 vertices / 124 triangles of level 0, a contiguous range of the index list (see buildMeshlets)
+struct Meshlet {
+    glm::vec3 center;   // bounding sphere, model space
+    float radius;
+    glm::vec3 coneAxis; // average facing of the triangles
+    float coneCutoff;   // > 1 if the cluster can't be cone culled
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+// sets the attribute pointers of the bound VAO for vertices of the given format in the bound GL_ARRAY_BUFFER
+inline void setupVertexAttributes(VertexFormat format)
+{
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        // same locations as the float layout; there is no bitangent (location 4)
+        // vertex Positions, normalized to [0, 1] within the mesh bounds
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        // vertex tangent and handedness
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+        return;
+    }
+
+    // vertex Positions
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // vertex normals
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    // vertex texture coords
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    // vertex tangent
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    // vertex bitangent
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+}
+
+// one vertex attribute read in place from a GL buffer, in whatever layout the source file uses (e.g. a glTF
+// accessor); see the Mesh constructor that takes these
+struct VertexAttribute {
+    GLuint location;      // 0 position, 1 normal, 2 texture coordinates, 3 tangent, 4 bitangent
+    GLint components;
+    GLenum type;          // GL_FLOAT, GL_UNSIGNED_SHORT, ...
+    GLboolean normalized;
+    GLsizei stride;
+    size_t offset;        // bytes into buffer
+    unsigned int buffer;  // GL buffer holding the data
+};
+
+inline size_t vertexStride(VertexFormat format)
+{
+    return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+inline size_t indexTypeSize(GLenum type)
+{
+    if (type == GL_UNSIGNED_BYTE)
+        return sizeof(unsigned char);
+    return type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+// Vertex and index data of several meshes in a single VBO/EBO pair behind one VAO. Meshes draw with
+// glDrawElementsBaseVertex, so their indices stay relative to their own first vertex (and can stay 16 bit).
+// allocate() sizes the buffers for all meshes once, add() then copies each mesh into its place straight from
+// where its data already is (the mapped cache or the import), without staging it.
+class GeometryPool {
+public:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    VertexFormat format;
+
+    explicit GeometryPool(VertexFormat format) : format(format) {}
+
+    // bytes of index buffer a mesh takes, with the alignment add() keeps; allocate() expects the sum over all meshes
+    static size_t indexSpace(size_t indexBytes)
+    {
+        return (indexBytes + 3) & ~(size_t)3;
+    }
+
+    // creates the GL objects with room for vertexCount vertices and indexBytes (see indexSpace) of indices
+    void allocate(size_t vertexCount, size_t indexBytes)
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexStride(format), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
+        setupVertexAttributes(format);
+        glBindVertexArray(0);
+        vertexEnd = indexEnd = 0;
+    }
+
+    // uploads a mesh behind the previous ones; baseVertex and indexOffset (in bytes) locate it within the pool
+    void add(const void *vertexData, size_t vertexCount, const void *indexData, size_t indexBytes, GLint &baseVertex, size_t &indexOffset)
+    {
+        size_t stride = vertexStride(format);
+        baseVertex = (GLint)vertexEnd;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, vertexEnd * stride, vertexCount * stride, vertexData);
+        vertexEnd += vertexCount;
+        // the element array binding belongs to whatever VAO is bound, so the indices go through the copy target
+        indexOffset = indexEnd;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, indexEnd, indexBytes, indexData);
+        indexEnd += indexSpace(indexBytes); // keep 32 bit index ranges aligned
+    }
+
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+private:
+    size_t vertexEnd = 0, indexEnd = 0; // vertices and index bytes added so far
+};
+
+// what a Mesh keeps on the CPU once its geometry is uploaded
+enum GeometryRetention {
+    GEOMETRY_KEEP,        // vertices and indices stay in memory
+    GEOMETRY_RELEASE,     // vertices, indices and meshlets are freed; level 0 is then always drawn whole
+    GEOMETRY_BOUNDS_ONLY  // vertices and indices are freed, the mesh and meshlet bounds stay for culling and picking
 };
 
 class Mesh {
@@ -38,68 +297,320 @@ public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
+    vector<unsigned short> shortIndices; // instead of indices when indexType is GL_UNSIGNED_SHORT
     vector<Texture>      textures;
 
     unsigned int VAO;
-    std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    unsigned int indexCount;
+    GLenum indexType; // as given to the constructor; the importer narrows meshes with fewer than 65536 vertices to GL_UNSIGNED_SHORT
+    VertexFormat vertexFormat;
+    glm::vec3 positionOffset, positionScale; // position decode, identity for VERTEX_FORMAT_FLOAT
+    // location of the mesh in its buffers, only non-zero for meshes in a GeometryPool (and indexOffset for glTF meshes)
+    GLint baseVertex = 0;
+    size_t indexOffset = 0;
+    // levels of detail, the index list holds all of them back to back; Draw renders lods[currentLod]
+    vector<MeshLod> lods;
+    unsigned int currentLod = 0;
+    // bounding sphere and box in model space
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    glm::vec3 boundsMin, boundsMax;
+    // meshlets of level 0; once culled (Model::PrepareDraw) the next draw only renders the ranges that survived
+    vector<Meshlet> meshlets;
+    bool visible = true;
+    bool meshletsCulled = false;
+    std::string glslIdentifierPrefix; // set through SetTextureNamePrefix
+    // constructor. With a pool (allocated for the mesh) the geometry is uploaded into it and VAO is the pool's.
+    // Without lods the whole index list is the only level.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VERTEX_FORMAT_FLOAT,
+         GeometryPool *pool = nullptr, vector<MeshLod> lods = vector<MeshLod>(), vector<Meshlet> meshlets = vector<Meshlet>())
+        : vertexFormat(format)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->lods = std::move(lods);
+        this->meshlets = std::move(meshlets);
+
+        // vertices in the GPU layout
+        MeshBounds bounds = computeBounds(this->vertices.data(), this->vertices.size(), format);
+        vector<PackedVertex> packed;
+        const void *gpuVertices = this->vertices.data();
+        if (format == VERTEX_FORMAT_PACKED)
+        {
+            packed.resize(this->vertices.size());
+            packVertices(this->vertices.data(), this->vertices.size(), packed.data(), bounds.positionOffset, bounds.positionScale);
+            gpuVertices = packed.data();
+        }
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(gpuVertices, this->vertices.size(), this->indices.data(), this->indices.size(), GL_UNSIGNED_INT, bounds, pool);
+    }
+
+    // constructor for geometry that already sits in memory in its final layout (e.g. a memory-mapped mesh cache):
+    // vertexData holds vertices of the given format, bounds were computed for them, indexType is GL_UNSIGNED_SHORT
+    // or GL_UNSIGNED_INT. The data is uploaded straight from the given pointers, vertices and indices stay empty.
+    Mesh(const void *vertexData, unsigned int vertexCount, const void *indexData, unsigned int indexCount, GLenum indexType,
+         const MeshBounds &bounds, vector<Texture> textures, VertexFormat format = VERTEX_FORMAT_FLOAT, GeometryPool *pool = nullptr,
+         vector<MeshLod> lods = vector<MeshLod>(), vector<Meshlet> meshlets = vector<Meshlet>())
+        : vertexFormat(format)
+    {
+        this->textures = std::move(textures);
+        this->lods = std::move(lods);
+        this->meshlets = std::move(meshlets);
+        setupMesh(vertexData, vertexCount, indexData, indexCount, indexType, bounds, pool);
+    }
+
+    // constructor for geometry that stays in the buffers it was uploaded to by the loader (GltfAsset): the VAO
+    // reads every attribute straight from them in the file's layout, no vertex is converted or copied. The
+    // buffers are not owned by the mesh.
+    Mesh(const vector<VertexAttribute> &attributes, unsigned int indexBuffer, size_t indexOffset, unsigned int indexCount, GLenum indexType,
+         const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, vector<Texture> textures)
+        : textures(std::move(textures)), indexCount(indexCount), indexType(indexType), vertexFormat(VERTEX_FORMAT_FLOAT),
+          positionOffset(0.0f), positionScale(1.0f), indexOffset(indexOffset), boundsMin(boundsMin), boundsMax(boundsMax)
+    {
+        lods.push_back({0, indexCount, 0.0f});
+        boundsCenter = (boundsMin + boundsMax) * 0.5f;
+        boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+        VBO = EBO = 0;
+
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        for (const VertexAttribute &attribute : attributes)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, attribute.stride,
+                                  (void*)attribute.offset);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     // render the mesh
     void Draw(Shader &shader)
     {
-        // bind appropriate textures
+        GLState::get().bindVertexArray(VAO);
+        DrawBound(shader);
+    }
+
+    // render the mesh with its VAO already bound, Model::Draw binds a shared VAO once for all its meshes
+    void DrawBound(Shader &shader)
+    {
+        if (!visible)
+            return;
+        BindTextures(shader);
+        DrawGeometry(shader);
+    }
+
+    // binds the textures to units 0..n-1 and points the samplers of shader at them. A RenderQueue only calls
+    // this when the material or the program changes between two draws.
+    void BindTextures(Shader &shader)
+    {
+        const MaterialTable &table = materialTable(shader);
+        for (const MaterialBinding &binding : table.bindings)
+        {
+            shader.set(binding.sampler, (int)binding.unit);
+            // GLState drops the bind if the unit already has the texture
+            GLState::get().bindTexture(binding.unit, GL_TEXTURE_2D, textureId(binding.unit));
+        }
+    }
+
+    // prefix of the sampler names (prefix + "texture_diffuse1", ...); the binding tables are resolved again
+    void SetTextureNamePrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        materialTables.clear();
+    }
+
+    // GL name of texture i, through the handle, so a hot reloaded texture is picked up
+    unsigned int textureId(size_t i) const
+    {
+        return textures[i].handle ? textures[i].handle.id() : textures[i].id;
+    }
+
+    // the draw call(s) of the current level or the visible meshlets, with the VAO and textures already bound
+    void DrawGeometry(Shader &shader)
+    {
+        const MaterialTable &table = materialTable(shader);
+        shader.set(table.positionOffset, positionOffset);
+        shader.set(table.positionScale, positionScale);
+
+        // draw mesh
+        if (currentLod == 0 && meshletsCulled)
+        {
+            if (!visibleCounts.empty())
+                glMultiDrawElementsBaseVertex(GL_TRIANGLES, visibleCounts.data(), indexType, visibleOffsets.data(),
+                                              (GLsizei)visibleCounts.size(), visibleBaseVertices.data());
+            // the ranges belong to the view of the last cull, other draws (passes, cameras) render the whole level
+            meshletsCulled = false;
+            return;
+        }
+        const MeshLod &lod = lods[currentLod];
+        glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, indexType, (void*)(indexOffset + lod.firstIndex * indexSize()), baseVertex);
+    }
+
+    // Culls the meshlets against the frustum planes and the camera position, both in model space. Planes point
+    // inwards and are normalized. A meshlet goes if its sphere is outside a plane or if all of its triangles
+    // face away from the camera; consecutive survivors are merged into one range of the multi draw.
+    // facing is the winding the draw keeps: 1 counter-clockwise, -1 clockwise, 0 no face culling (no cone test).
+    // Returns the number of meshlets kept.
+    size_t cullMeshlets(const glm::vec4 planes[6], const glm::vec3 &cameraPosition, float facing = 1.0f)
+    {
+        visibleCounts.clear();
+        visibleOffsets.clear();
+        visibleBaseVertices.clear();
+        meshletsCulled = true;
+        size_t kept = 0;
+        unsigned int rangeEnd = ~0u;
+        for (const Meshlet &meshlet : meshlets)
+        {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++)
+                inside = glm::dot(glm::vec3(planes[p]), meshlet.center) + planes[p].w > -meshlet.radius;
+            if (!inside)
+                continue;
+            glm::vec3 toCenter = meshlet.center - cameraPosition;
+            if (facing != 0.0f && glm::dot(toCenter, meshlet.coneAxis * facing) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+                continue;
+            kept++;
+            if (meshlet.firstIndex == rangeEnd)
+                visibleCounts.back() += meshlet.indexCount;
+            else
+            {
+                visibleCounts.push_back(meshlet.indexCount);
+                visibleOffsets.push_back((const void *)(indexOffset + meshlet.firstIndex * indexSize()));
+                visibleBaseVertices.push_back(baseVertex);
+            }
+            rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+        }
+        return kept;
+    }
+
+    // frees the CPU copy of the geometry once it is uploaded (to the mesh's own buffers or a GeometryPool)
+    void releaseGeometry(GeometryRetention retention)
+    {
+        if (retention == GEOMETRY_KEEP)
+            return;
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+        vector<unsigned short>().swap(shortIndices);
+        if (retention == GEOMETRY_RELEASE)
+        {
+            vector<Meshlet>().swap(meshlets);
+            vector<GLsizei>().swap(visibleCounts);
+            vector<const void *>().swap(visibleOffsets);
+            vector<GLint>().swap(visibleBaseVertices);
+            meshletsCulled = false;
+        }
+    }
+
+    // deletes the buffers of a mesh that has its own (not in a GeometryPool); for glTF meshes only the VAO
+    void release()
+    {
+        if (VAO == 0)
+            return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+private:
+    // texture unit (= index into textures) and the sampler uniform pointed at it
+    struct MaterialBinding {
+        unsigned int unit;
+        UniformHandle<int> sampler;
+    };
+    // the uniforms of the mesh in one shader (by Shader::getSerial), resolved by name once. Handles survive
+    // hot reloads of the shader; texture ids are read through the handles at bind time, so reloaded textures
+    // are picked up too.
+    struct MaterialTable {
+        uint64_t shader;
+        vector<MaterialBinding> bindings;
+        UniformHandle<glm::vec3> positionOffset, positionScale;
+    };
+
+    // render data
+    unsigned int VBO, EBO;
+    // one table per shader the mesh was drawn with, usually one or two
+    vector<MaterialTable> materialTables;
+    size_t lastMaterialTable = 0;
+    // multi draw ranges of the visible meshlets, capacity stays allocated between frames
+    vector<GLsizei> visibleCounts;
+    vector<const void *> visibleOffsets;
+    vector<GLint> visibleBaseVertices;
+
+    size_t indexSize() const
+    {
+        return indexTypeSize(indexType);
+    }
+
+    // the table of shader, built on the first draw with it; later draws do no string work or allocation
+    const MaterialTable &materialTable(Shader &shader)
+    {
+        uint64_t serial = shader.getSerial();
+        if (lastMaterialTable < materialTables.size() && materialTables[lastMaterialTable].shader == serial)
+            return materialTables[lastMaterialTable];
+        for (lastMaterialTable = 0; lastMaterialTable < materialTables.size(); lastMaterialTable++)
+            if (materialTables[lastMaterialTable].shader == serial)
+                return materialTables[lastMaterialTable];
+
+        MaterialTable table;
+        table.shader = serial;
+        table.positionOffset = shader.uniform<glm::vec3>("positionOffset");
+        table.positionScale = shader.uniform<glm::vec3>("positionScale");
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        for (unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
-            string name = textures[i].type;
+            const string &name = textures[i].type;
             if(name == "texture_diffuse")
                 number = std::to_string(diffuseNr++);
             else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
+                number = std::to_string(specularNr++);
             else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
+                number = std::to_string(normalNr++);
             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+                number = std::to_string(heightNr++);
+            table.bindings.push_back(MaterialBinding{i, shader.uniform<int>(glslIdentifierPrefix + name + number)});
         }
+        materialTables.push_back(std::move(table));
+        return materialTables.back();
+    }
 
+    // initializes all the buffer objects/arrays
+    void setupMesh(const void *gpuVertices, size_t vertexCount, const void *indexData, size_t indexCount, GLenum indexType,
+                   const MeshBounds &bounds, GeometryPool *pool)
+    {
+        this->indexCount = (unsigned int)indexCount;
+        this->indexType = indexType;
+        if (lods.empty())
+            lods.push_back({0, (unsigned int)indexCount, 0.0f});
 
+        boundsMin = bounds.min;
+        boundsMax = bounds.max;
+        boundsCenter = bounds.center;
+        boundsRadius = bounds.radius;
+        positionOffset = bounds.positionOffset;
+        positionScale = bounds.positionScale;
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
-    }
+        // the indices are uploaded in the width they come in
+        size_t indexBytes = indexCount * indexSize();
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+        if (pool)
+        {
+            VAO = pool->VAO;
+            VBO = EBO = 0;
+            pool->add(gpuVertices, vertexCount, indexData, indexBytes, baseVertex, indexOffset);
+            return;
+        }
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -111,29 +622,15 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexStride(vertexFormat), gpuVertices, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        setupVertexAttributes(vertexFormat);
 
         glBindVertexArray(0);
     }
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,396 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/vfs.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <vector>
+using namespace std;
+
+// On-disk cache of the meshes produced by Model::loadModel. A cache file is only valid for the
+// source file (path and modification time), import flags, model processing options and format version it
+// was written with, anything else is treated as a miss and the model is imported again.
+//
+// File layout:
+//   MeshCacheHeader | source path | per mesh: MeshCacheMeshHeader, MeshBounds, textures, lods, meshlets, padding, vertices, indices
+// Vertices are stored in the GPU layout (VertexFormat, part of the cache key) with their bounds and position decode.
+// The index array holds all levels of detail of a mesh back to back, the lod table (MeshLod) locates them.
+// Indices are stored in the width the importer picked (MeshCacheMeshHeader::indexSize) and uploaded as they are.
+// Vertex and index arrays start on an 8 byte boundary so they can be used in place once the file is mapped.
+
+const uint32_t MESH_CACHE_MAGIC   = 0x4853454d; // "MESH"
+const uint32_t MESH_CACHE_VERSION = 7;
+const char *const MESH_CACHE_DIRECTORY = "resources/cache"; // relative to the resource root (FileSystem::getPath)
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t processFlags; // ModelOptions::cacheFlags()
+    uint32_t vertexSize;   // vertexStride of the stored layout
+    int64_t  sourceMtime;
+    uint32_t sourcePathLength;
+    uint32_t meshCount;
+};
+
+struct MeshCacheMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    uint32_t indexSize; // 2 or 4 bytes
+};
+
+// material texture reference as stored in the cache (path is relative to the model directory)
+struct CachedTexture {
+    string type;
+    string path;
+};
+
+// view of one mesh inside a mapped cache file, the pointers stay valid while the MeshCache is open
+struct CachedMesh {
+    const void         *vertices;   // in the layout the cache was opened for
+    unsigned int        vertexCount;
+    const void         *indices;
+    unsigned int        indexCount;
+    GLenum              indexType;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    MeshBounds          bounds;
+    vector<CachedTexture> textures;
+    vector<MeshLod>     lods;
+    vector<Meshlet>     meshlets;
+};
+
+// CPU side result of importing one mesh, what MeshCache::write stores
+struct MeshData {
+    vector<Vertex>         vertices;
+    vector<PackedVertex>   packedVertices; // what is uploaded and cached for VERTEX_FORMAT_PACKED
+    VertexFormat           vertexFormat = VERTEX_FORMAT_FLOAT;
+    MeshBounds             bounds;
+    vector<unsigned int>   indices;
+    vector<unsigned short> shortIndices; // replace indices once the importer narrowed them (fewer than 65536 vertices)
+    GLenum                 indexType = GL_UNSIGNED_INT;
+    vector<CachedTexture>  textures;
+    vector<MeshLod>        lods;
+    vector<Meshlet>        meshlets;
+
+    const void *vertexData() const
+    {
+        return vertexFormat == VERTEX_FORMAT_PACKED ? (const void *)packedVertices.data() : (const void *)vertices.data();
+    }
+    const void *indexData() const
+    {
+        return indexType == GL_UNSIGNED_SHORT ? (const void *)shortIndices.data() : (const void *)indices.data();
+    }
+    size_t indexCount() const { return indexType == GL_UNSIGNED_SHORT ? shortIndices.size() : indices.size(); }
+    size_t indexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int); }
+};
+
+class MeshCache
+{
+public:
+    vector<CachedMesh> meshes;
+
+    MeshCache() : mapping(nullptr), mappingSize(0) {}
+    ~MeshCache() { close(); }
+
+    MeshCache(const MeshCache &) = delete;
+    MeshCache &operator=(const MeshCache &) = delete;
+
+    // maps the cache file that belongs to sourcePath. Returns false if there is no cache file or if it is stale.
+    // A cache file packed into the mounted archive is used in place; the archive is a consistent snapshot, so
+    // its cache is not checked against the modification time of a loose source file (which may not exist).
+    bool open(const string &sourcePath, unsigned int importFlags, unsigned int processFlags, VertexFormat format)
+    {
+        close();
+        const unsigned char *packed;
+        size_t packedSize;
+        if (Vfs::get().findInArchive(cacheFileFor(sourcePath), packed, packedSize))
+        {
+            if (packedSize < sizeof(MeshCacheHeader) || !parse((const char *)packed, packedSize, sourcePath, importFlags, processFlags, format, nullptr))
+            {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        int64_t mtime;
+        if (!sourceModificationTime(sourcePath, mtime))
+            return false;
+
+        int fd = ::open(cacheFileFor(sourcePath).c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MeshCacheHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        mappingSize = (size_t)st.st_size;
+        mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps its own reference to the file
+        if (mapping == MAP_FAILED)
+        {
+            mapping = nullptr;
+            mappingSize = 0;
+            return false;
+        }
+        Vfs::get().recordRead(cacheFileFor(sourcePath));
+
+        if (!parse((const char *)mapping, mappingSize, sourcePath, importFlags, processFlags, format, &mtime))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        meshes.clear();
+        if (mapping)
+            munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+
+    // writes the imported meshes of sourcePath, in the GPU layout format, to the cache. The file is written under a temporary name and
+    // renamed into place so a crashed or concurrent writer never leaves a half written cache behind.
+    static bool write(const string &sourcePath, unsigned int importFlags, unsigned int processFlags, VertexFormat format,
+                      const vector<MeshData> &meshes)
+    {
+        int64_t mtime;
+        if (!sourceModificationTime(sourcePath, mtime))
+            return false;
+        if (!FileSystem::createDirectories(FileSystem::getPath(MESH_CACHE_DIRECTORY)))
+            return false;
+        for (const MeshData &mesh : meshes)
+            if (mesh.vertexFormat != format)
+                return false;
+
+        string cachePath = cacheFileFor(sourcePath);
+        string tmpPath = cachePath + ".tmp";
+        ofstream out(tmpPath, ios::binary | ios::trunc);
+        if (!out)
+            return false;
+
+        MeshCacheHeader header;
+        header.magic = MESH_CACHE_MAGIC;
+        header.version = MESH_CACHE_VERSION;
+        header.importFlags = importFlags;
+        header.processFlags = processFlags;
+        header.vertexSize = (uint32_t)vertexStride(format);
+        header.sourceMtime = mtime;
+        header.sourcePathLength = (uint32_t)sourcePath.size();
+        header.meshCount = (uint32_t)meshes.size();
+        out.write((const char *)&header, sizeof(header));
+        out.write(sourcePath.data(), sourcePath.size());
+
+        for (const MeshData &mesh : meshes)
+        {
+            MeshCacheMeshHeader meshHeader;
+            meshHeader.vertexCount = (uint32_t)mesh.vertices.size();
+            meshHeader.indexCount = (uint32_t)mesh.indexCount();
+            meshHeader.textureCount = (uint32_t)mesh.textures.size();
+            meshHeader.lodCount = (uint32_t)mesh.lods.size();
+            meshHeader.meshletCount = (uint32_t)mesh.meshlets.size();
+            meshHeader.indexSize = (uint32_t)mesh.indexSize();
+            out.write((const char *)&meshHeader, sizeof(meshHeader));
+            out.write((const char *)&mesh.bounds, sizeof(MeshBounds));
+            for (const CachedTexture &texture : mesh.textures)
+            {
+                writeString(out, texture.type);
+                writeString(out, texture.path);
+            }
+            out.write((const char *)mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+            out.write((const char *)mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+            pad(out);
+            out.write((const char *)mesh.vertexData(), mesh.vertices.size() * vertexStride(format));
+            pad(out);
+            out.write((const char *)mesh.indexData(), mesh.indexCount() * mesh.indexSize());
+        }
+        out.close();
+        if (!out || std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    static string cacheFileFor(const string &sourcePath)
+    {
+        // FNV-1a of the source path, the path itself is stored in the file to rule out collisions
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : sourcePath)
+        {
+            hash ^= (unsigned char)c;
+            hash *= 1099511628211ull;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        return FileSystem::getPath(string(MESH_CACHE_DIRECTORY) + "/" + name + ".meshcache");
+    }
+
+private:
+    void  *mapping;
+    size_t mappingSize;
+
+    static bool sourceModificationTime(const string &path, int64_t &mtime)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        mtime = (int64_t)st.st_mtime;
+        return true;
+    }
+
+    static void writeString(ofstream &out, const string &s)
+    {
+        uint32_t length = (uint32_t)s.size();
+        out.write((const char *)&length, sizeof(length));
+        out.write(s.data(), s.size());
+    }
+
+    static void pad(ofstream &out)
+    {
+        static const char zeros[8] = {0};
+        size_t position = (size_t)out.tellp();
+        out.write(zeros, (8 - position % 8) % 8);
+    }
+
+    // mtime is null for caches that come from the archive
+    bool parse(const char *base, size_t size, const string &sourcePath, unsigned int importFlags, unsigned int processFlags, VertexFormat format,
+               const int64_t *mtime)
+    {
+        const char *end = base + size;
+        const char *p = base;
+
+        MeshCacheHeader header;
+        memcpy(&header, p, sizeof(header));
+        p += sizeof(header);
+        if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+            header.importFlags != importFlags || header.processFlags != processFlags || header.vertexSize != vertexStride(format) ||
+            (mtime && header.sourceMtime != *mtime) || header.sourcePathLength != sourcePath.size())
+            return false;
+        if ((size_t)(end - p) < header.sourcePathLength || sourcePath.compare(0, string::npos, p, header.sourcePathLength) != 0)
+            return false;
+        p += header.sourcePathLength;
+
+        if (header.meshCount > (size_t)(end - p) / sizeof(MeshCacheMeshHeader))
+            return false;
+        meshes.reserve(header.meshCount);
+        for (uint32_t i = 0; i < header.meshCount; i++)
+        {
+            MeshCacheMeshHeader meshHeader;
+            if ((size_t)(end - p) < sizeof(meshHeader))
+                return false;
+            memcpy(&meshHeader, p, sizeof(meshHeader));
+            p += sizeof(meshHeader);
+
+            CachedMesh mesh;
+            if ((size_t)(end - p) < sizeof(MeshBounds))
+                return false;
+            memcpy(&mesh.bounds, p, sizeof(MeshBounds));
+            p += sizeof(MeshBounds);
+            for (uint32_t t = 0; t < meshHeader.textureCount; t++)
+            {
+                CachedTexture texture;
+                if (!readString(p, end, texture.type) || !readString(p, end, texture.path))
+                    return false;
+                mesh.textures.push_back(texture);
+            }
+            size_t lodBytes = (size_t)meshHeader.lodCount * sizeof(MeshLod);
+            if ((size_t)(end - p) < lodBytes)
+                return false;
+            mesh.lods.resize(meshHeader.lodCount);
+            memcpy(mesh.lods.data(), p, lodBytes);
+            p += lodBytes;
+            for (const MeshLod &lod : mesh.lods)
+                if ((uint64_t)lod.firstIndex + lod.indexCount > meshHeader.indexCount)
+                    return false;
+            size_t meshletBytes = (size_t)meshHeader.meshletCount * sizeof(Meshlet);
+            if ((size_t)(end - p) < meshletBytes)
+                return false;
+            mesh.meshlets.resize(meshHeader.meshletCount);
+            memcpy(mesh.meshlets.data(), p, meshletBytes);
+            p += meshletBytes;
+            for (const Meshlet &meshlet : mesh.meshlets)
+                if ((uint64_t)meshlet.firstIndex + meshlet.indexCount > meshHeader.indexCount)
+                    return false;
+            if (!align(base, end, p))
+                return false;
+            size_t vertexBytes = (size_t)meshHeader.vertexCount * header.vertexSize;
+            if ((size_t)(end - p) < vertexBytes)
+                return false;
+            mesh.vertices = p;
+            mesh.vertexCount = meshHeader.vertexCount;
+            p += vertexBytes;
+
+            if (!align(base, end, p) || (meshHeader.indexSize != sizeof(unsigned short) && meshHeader.indexSize != sizeof(unsigned int)))
+                return false;
+            size_t indexBytes = (size_t)meshHeader.indexCount * meshHeader.indexSize;
+            if ((size_t)(end - p) < indexBytes)
+                return false;
+            mesh.indices = p;
+            mesh.indexCount = meshHeader.indexCount;
+            mesh.indexType = meshHeader.indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            p += indexBytes;
+            // a corrupt index would make the GPU read past the vertex buffer
+            if (mesh.indexType == GL_UNSIGNED_SHORT ? !indicesInRange((const unsigned short *)mesh.indices, mesh.indexCount, mesh.vertexCount)
+                                                    : !indicesInRange((const unsigned int *)mesh.indices, mesh.indexCount, mesh.vertexCount))
+                return false;
+
+            meshes.push_back(mesh);
+        }
+        return true;
+    }
+
+    template <typename T>
+    static bool indicesInRange(const T *indices, unsigned int count, unsigned int vertexCount)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            if (indices[i] >= vertexCount)
+                return false;
+        return true;
+    }
+
+    static bool readString(const char *&p, const char *end, string &s)
+    {
+        uint32_t length;
+        if ((size_t)(end - p) < sizeof(length))
+            return false;
+        memcpy(&length, p, sizeof(length));
+        p += sizeof(length);
+        if ((size_t)(end - p) < length)
+            return false;
+        s.assign(p, length);
+        p += length;
+        return true;
+    }
+
+    // moves p to the next 8 byte boundary; false if that is past end (truncated file)
+    static bool align(const char *base, const char *end, const char *&p)
+    {
+        size_t padding = (8 - (size_t)(p - base) % 8) % 8;
+        if ((size_t)(end - p) < padding)
+            return false;
+        p += padding;
+        return true;
+    }
+};
+#endif
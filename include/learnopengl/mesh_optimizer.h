@@ -0,0 +1,675 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Post-import processing of indexed triangle lists. weldVertices merges duplicated vertices, the
+// optimization passes reorder the result:
+//  1. optimizeVertexCache  - triangle order for post-transform cache reuse (Forsyth's linear-speed algorithm)
+//  2. optimizeOverdraw     - reorders clusters of that order so outward facing clusters are drawn first
+//  3. optimizeVertexFetch  - renumbers vertices in first-use order so vertex fetches walk memory linearly
+// The passes only permute data, the rendered result is unchanged. simplifyMesh builds the index lists of
+// coarser levels of detail on top of the same vertices.
+
+// Merges vertices whose attributes (position, normal, uv, tangent, bitangent) all agree within tolerance.
+// Every component is snapped to a grid of that size and the snapped vertex is hashed, so two vertices weld
+// when they land in the same grid cell. Indices are rewritten, the first vertex of every cell is kept.
+void weldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices, float tolerance = 1e-5f)
+{
+    const int componentCount = sizeof(Vertex) / sizeof(float);
+    static_assert(sizeof(Vertex) == componentCount * sizeof(float), "Vertex must consist of floats only");
+    if (vertices.empty())
+        return;
+
+    vector<int64_t> keys(vertices.size() * componentCount);
+    vector<uint64_t> hashes(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        const float *components = (const float *)&vertices[v];
+        int64_t *key = &keys[v * componentCount];
+        uint64_t hash = 14695981039346656037ull;
+        for (int c = 0; c < componentCount; c++)
+        {
+            key[c] = (int64_t)llround(components[c] / tolerance);
+            hash = (hash ^ (uint64_t)key[c]) * 1099511628211ull;
+        }
+        hashes[v] = hash;
+    }
+
+    // open addressing table of unique vertex indices, at most half full
+    size_t tableSize = 1;
+    while (tableSize < vertices.size() * 2)
+        tableSize *= 2;
+    const unsigned int empty = ~0u;
+    vector<unsigned int> table(tableSize, empty);
+    vector<unsigned int> remap(vertices.size());
+    vector<Vertex> result;
+    result.reserve(vertices.size());
+    vector<size_t> uniqueSource; // original index of every kept vertex, for the key comparison
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        size_t slot = hashes[v] & (tableSize - 1);
+        for (;;)
+        {
+            unsigned int candidate = table[slot];
+            if (candidate == empty)
+            {
+                table[slot] = (unsigned int)result.size();
+                remap[v] = (unsigned int)result.size();
+                uniqueSource.push_back(v);
+                result.push_back(vertices[v]);
+                break;
+            }
+            size_t source = uniqueSource[candidate];
+            if (hashes[source] == hashes[v] &&
+                memcmp(&keys[source * componentCount], &keys[v * componentCount], componentCount * sizeof(int64_t)) == 0)
+            {
+                remap[v] = candidate;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+    vertices.swap(result);
+}
+
+// statistics of a simulated FIFO post-transform cache
+struct VertexCacheStats {
+    size_t misses = 0;
+    size_t triangles = 0;
+    size_t vertices = 0; // referenced vertices
+
+    // average cache miss ratio: transformed vertices per triangle (0.5 is the ideal for large meshes)
+    float acmr() const
+    {
+        return triangles ? (float)misses / triangles : 0.0f;
+    }
+
+    // average transform to vertex ratio: transformed vertices per referenced vertex (1.0 is ideal)
+    float atvr() const
+    {
+        return vertices ? (float)misses / vertices : 0.0f;
+    }
+
+    void add(const VertexCacheStats &other)
+    {
+        misses += other.misses;
+        triangles += other.triangles;
+        vertices += other.vertices;
+    }
+};
+
+VertexCacheStats analyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+    VertexCacheStats stats;
+    vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    for (unsigned int index : indices)
+    {
+        if (time - timestamps[index] > cacheSize)
+        {
+            if (timestamps[index] == 0)
+                stats.vertices++;
+            timestamps[index] = time++;
+            stats.misses++;
+        }
+    }
+    stats.triangles = indices.size() / 3;
+    return stats;
+}
+
+static float forsythVertexScore(int cachePosition, unsigned int remainingTriangles, int cacheSize)
+{
+    if (remainingTriangles == 0)
+        return -1.0f; // no triangle needs this vertex any more
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // the three vertices of the last triangle get a fixed score so the next triangle doesn't just reuse them
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), 1.5f);
+    }
+    // prefer vertices with few remaining triangles, so they can leave the cache for good
+    score += 2.0f * powf((float)remainingTriangles, -0.5f);
+    return score;
+}
+
+void optimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+{
+    const int cacheSize = 32;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangle adjacency, the first remaining[v] entries of a vertex are its unemitted triangles
+    vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    vector<unsigned int> adjacency(indices.size());
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = forsythVertexScore(-1, remaining[v], cacheSize);
+    vector<char> emitted(triangleCount, 0);
+
+    auto triangleScore = [&](size_t t) {
+        return vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    };
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    vector<unsigned int> cache, newCache;
+    size_t cursor = 0; // next candidate when the cache offers no triangle
+
+    long best = 0;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        float score = triangleScore(t);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = (long)t;
+        }
+    }
+
+    while (result.size() < indices.size())
+    {
+        if (best < 0)
+        {
+            while (emitted[cursor])
+                cursor++;
+            best = (long)cursor;
+        }
+        emitted[best] = 1;
+        const unsigned int *tri = &indices[best * 3];
+        newCache.assign(tri, tri + 3);
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = tri[k];
+            result.push_back(v);
+            // drop the triangle from the vertex's remaining list
+            unsigned int *list = &adjacency[offsets[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++)
+                if (list[i] == (unsigned int)best)
+                {
+                    std::swap(list[i], list[remaining[v] - 1]);
+                    break;
+                }
+            remaining[v]--;
+        }
+        for (unsigned int v : cache)
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache.push_back(v);
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < (size_t)cacheSize ? (int)i : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v], cacheSize);
+        }
+        if (newCache.size() > (size_t)cacheSize)
+            newCache.resize(cacheSize);
+        cache.swap(newCache);
+
+        // the next triangle is the best one that touches the cache
+        best = -1;
+        bestScore = -1.0f;
+        for (unsigned int v : cache)
+            for (unsigned int i = 0; i < remaining[v]; i++)
+            {
+                unsigned int t = adjacency[offsets[v] + i];
+                float score = triangleScore(t);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = (long)t;
+                }
+            }
+    }
+    indices.swap(result);
+}
+
+// Splits the (cache optimized) triangle order into clusters at hard cache boundaries, i.e. triangles whose
+// three vertices all miss the cache, and sorts the clusters so the ones facing away from the mesh center
+// come first; they tend to occlude the rest. Reordering whole clusters keeps most of the cache efficiency.
+void optimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, unsigned int cacheSize = 16)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2 || vertices.empty())
+        return;
+
+    vector<size_t> clusterStart;
+    vector<unsigned int> timestamps(vertices.size(), 0);
+    unsigned int time = cacheSize + 1;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+            clusterStart.push_back(t);
+    }
+    clusterStart.push_back(triangleCount);
+    size_t clusterCount = clusterStart.size() - 1;
+    if (clusterCount < 2)
+        return;
+
+    glm::vec3 meshCenter(0.0f);
+    for (const Vertex &vertex : vertices)
+        meshCenter += vertex.Position;
+    meshCenter = meshCenter / (float)vertices.size();
+
+    vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+        {
+            const glm::vec3 &a = vertices[indices[t * 3]].Position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &d = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 n = glm::cross(b - a, d - a); // length is twice the triangle area
+            float w = glm::length(n);
+            center += (a + b + d) * (w / 3.0f);
+            normal += n;
+            area += w;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f)
+            sortKey[c] = glm::dot(center / area - meshCenter, normal / normalLength);
+        else
+            sortKey[c] = 0.0f;
+    }
+
+    vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+    indices.swap(result);
+}
+
+// renumbers vertices in the order the index buffer first uses them; unreferenced vertices are dropped
+void optimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = (unsigned int)result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
+
+// symmetric 4x4 plane quadric (the 10 distinct coefficients) and the total area it was accumulated from
+struct Quadric {
+    double a2 = 0, b2 = 0, c2 = 0, d2 = 0, ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+    double weight = 0;
+
+    void addPlane(double a, double b, double c, double d, double w)
+    {
+        a2 += w * a * a; b2 += w * b * b; c2 += w * c * c; d2 += w * d * d;
+        ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        bc += w * b * c; bd += w * b * d; cd += w * c * d;
+        weight += w;
+    }
+
+    void add(const Quadric &q)
+    {
+        a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+        ab += q.ab; ac += q.ac; ad += q.ad;
+        bc += q.bc; bd += q.bd; cd += q.cd;
+        weight += q.weight;
+    }
+
+    // area weighted mean squared distance of p to the accumulated planes
+    double error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double r = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+                   2.0 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+        return weight > 0.0 ? fabs(r) / weight : 0.0;
+    }
+};
+
+// Quadric error metric simplification (Garland & Heckbert) that collapses edges into one of their end points,
+// so every level of detail indexes the vertex buffer of the base mesh. Returns the simplified index list with
+// about targetIndexCount indices (more if the mesh can't be reduced further); error receives the largest
+// collapse error as a distance in model units.
+// Vertices on open borders never move. A vertex on an attribute seam (two vertices sharing one position, e.g.
+// a UV or normal split) only collapses along the seam, together with its twin onto the twin of the target, so
+// both sides of the seam stay attached. Positions shared by more than two vertices never move. Weld the mesh first.
+vector<unsigned int> simplifyMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t targetIndexCount, float &error)
+{
+    size_t vertexCount = vertices.size();
+    vector<unsigned int> result = indices;
+    error = 0.0f;
+    if (result.size() <= targetIndexCount)
+        return result;
+
+    // find seams: sort by position and look for runs of equal positions. twin is the other vertex of a pair,
+    // runs of three or more are locked
+    vector<char> locked(vertexCount, 0);
+    vector<unsigned int> twin(vertexCount, ~0u);
+    vector<unsigned int> byPosition(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        byPosition[v] = (unsigned int)v;
+    auto positionLess = [&](unsigned int a, unsigned int b) {
+        const glm::vec3 &p = vertices[a].Position, &q = vertices[b].Position;
+        return p.x != q.x ? p.x < q.x : (p.y != q.y ? p.y < q.y : p.z < q.z);
+    };
+    std::sort(byPosition.begin(), byPosition.end(), positionLess);
+    vector<unsigned int> positionId(vertexCount);
+    for (size_t i = 0, run = 0; i < vertexCount; i++)
+    {
+        if (i > 0 && positionLess(byPosition[i - 1], byPosition[i]))
+            run = i;
+        positionId[byPosition[i]] = byPosition[run];
+    }
+    for (size_t run = 0, next; run < vertexCount; run = next)
+    {
+        for (next = run + 1; next < vertexCount && !positionLess(byPosition[run], byPosition[next]); next++)
+            ;
+        if (next - run == 2)
+        {
+            twin[byPosition[run]] = byPosition[run + 1];
+            twin[byPosition[run + 1]] = byPosition[run];
+        }
+        else if (next - run > 2)
+            for (size_t i = run; i < next; i++)
+                locked[byPosition[i]] = 1;
+    }
+
+    // lock border vertices: edges (between positions) that only one triangle uses
+    unordered_map<uint64_t, unsigned int> edgeUse;
+    for (size_t i = 0; i < result.size(); i += 3)
+        for (int k = 0; k < 3; k++)
+        {
+            uint64_t a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+            edgeUse[a < b ? (a << 32 | b) : (b << 32 | a)]++;
+        }
+    for (size_t i = 0; i < result.size(); i += 3)
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+            uint64_t pa = positionId[a], pb = positionId[b];
+            if (edgeUse[pa < pb ? (pa << 32 | pb) : (pb << 32 | pa)] == 1)
+                locked[a] = locked[b] = 1;
+        }
+
+    vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3 &a = vertices[result[i]].Position, &b = vertices[result[i + 1]].Position, &c = vertices[result[i + 2]].Position;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length == 0.0f)
+            continue;
+        n = n / length;
+        Quadric q;
+        q.addPlane(n.x, n.y, n.z, -glm::dot(n, a), length * 0.5f);
+        for (int k = 0; k < 3; k++)
+            quadrics[result[i + k]].add(q);
+    }
+
+    // a collapse moves from onto to; on a seam fromTwin moves onto toTwin as well
+    struct Collapse {
+        unsigned int from, to;
+        unsigned int fromTwin, toTwin;
+        double error;
+    };
+    vector<Collapse> collapses;
+    vector<unsigned int> offsets, adjacency, remap(vertexCount);
+    vector<char> touched(vertexCount);
+    // every pass collapses a set of edges that don't share a neighbourhood, cheapest first
+    while (result.size() > targetIndexCount)
+    {
+        // vertex -> triangle adjacency of the current result
+        offsets.assign(vertexCount + 1, 0);
+        for (unsigned int index : result)
+            offsets[index + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(result.size());
+        vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+            adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+        // whether some triangle of the current result has the edge a-b
+        auto hasEdge = [&](unsigned int a, unsigned int b) {
+            for (unsigned int t = offsets[a]; t < offsets[a + 1]; t++)
+            {
+                const unsigned int *tri = &result[adjacency[t] * 3];
+                if (tri[0] == b || tri[1] == b || tri[2] == b)
+                    return true;
+            }
+            return false;
+        };
+        // from can move onto to: a seam vertex only along the seam, i.e. when its twin has an edge to the twin of to
+        auto addCollapse = [&](unsigned int from, unsigned int to) {
+            if (locked[from] || positionId[from] == positionId[to])
+                return;
+            Quadric q = quadrics[from];
+            q.add(quadrics[to]);
+            unsigned int fromTwin = twin[from], toTwin = ~0u;
+            if (fromTwin != ~0u)
+            {
+                toTwin = twin[to];
+                if (toTwin == ~0u || locked[fromTwin] || !hasEdge(fromTwin, toTwin))
+                    return;
+                q.add(quadrics[fromTwin]);
+                q.add(quadrics[toTwin]);
+            }
+            collapses.push_back({from, to, fromTwin, toTwin, q.error(vertices[to].Position)});
+        };
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                addCollapse(a, b);
+                addCollapse(b, a);
+            }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.error < y.error; });
+
+        for (size_t v = 0; v < vertexCount; v++)
+            remap[v] = (unsigned int)v;
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3, removed = 0, applied = 0;
+        // triangles around from that survive moving it onto to must not flip; counts the ones that collapse
+        auto flips = [&](unsigned int from, unsigned int to, size_t &collapsed) {
+            for (unsigned int a = offsets[from]; a < offsets[from + 1]; a++)
+            {
+                const unsigned int *tri = &result[adjacency[a] * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to)
+                {
+                    collapsed++;
+                    continue;
+                }
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = vertices[tri[k]].Position;
+                    q[k] = tri[k] == from ? vertices[to].Position : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0f)
+                    return true;
+            }
+            return false;
+        };
+        auto touch = [&](unsigned int v) {
+            for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++)
+                for (int k = 0; k < 3; k++)
+                    touched[result[adjacency[a] * 3 + k]] = 1;
+        };
+        for (const Collapse &collapse : collapses)
+        {
+            if (removed >= trianglesToRemove)
+                break;
+            unsigned int from = collapse.from, to = collapse.to;
+            bool seam = collapse.fromTwin != ~0u;
+            if (touched[from] || touched[to] || (seam && (touched[collapse.fromTwin] || touched[collapse.toTwin])))
+                continue;
+            size_t collapsed = 0;
+            if (flips(from, to, collapsed) || (seam && flips(collapse.fromTwin, collapse.toTwin, collapsed)))
+                continue;
+
+            remap[from] = to;
+            quadrics[to].add(quadrics[from]);
+            touch(from);
+            if (seam)
+            {
+                remap[collapse.fromTwin] = collapse.toTwin;
+                quadrics[collapse.toTwin].add(quadrics[collapse.fromTwin]);
+                touch(collapse.fromTwin);
+            }
+            error = std::max(error, (float)sqrt(collapse.error));
+            removed += collapsed;
+            applied++;
+        }
+        if (applied == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+    return result;
+}
+
+// Splits the first indexCount indices (a triangle list, ideally cache optimized) into meshlets of consecutive
+// triangles with at most maxVertices unique vertices and maxTriangles triangles, so every meshlet stays a
+// single index range. Each one gets a bounding sphere and a normal cone for backface culling of the cluster.
+vector<Meshlet> buildMeshlets(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t indexCount,
+                              unsigned int maxVertices = 64, unsigned int maxTriangles = 124)
+{
+    vector<Meshlet> meshlets;
+    vector<unsigned int> owner(vertices.size(), ~0u); // last meshlet that used a vertex
+    size_t first = 0;
+    unsigned int vertexCount = 0;
+    auto finish = [&](size_t end) {
+        Meshlet meshlet;
+        meshlet.firstIndex = (unsigned int)first;
+        meshlet.indexCount = (unsigned int)(end - first);
+
+        glm::vec3 lo = vertices[indices[first]].Position, hi = lo;
+        for (size_t i = first; i < end; i++)
+        {
+            lo = glm::min(lo, vertices[indices[i]].Position);
+            hi = glm::max(hi, vertices[indices[i]].Position);
+        }
+        meshlet.center = (lo + hi) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (size_t i = first; i < end; i++)
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.center));
+
+        // cone around the average triangle normal that holds all triangle normals; the cluster is invisible
+        // from every direction within the cone's complement, i.e. dot(view, axis) >= sin(max angle)
+        glm::vec3 normals(0.0f);
+        vector<glm::vec3> faceNormals;
+        for (size_t i = first; i < end; i += 3)
+        {
+            const glm::vec3 &a = vertices[indices[i]].Position;
+            glm::vec3 n = glm::cross(vertices[indices[i + 1]].Position - a, vertices[indices[i + 2]].Position - a);
+            float length = glm::length(n);
+            if (length > 0.0f)
+            {
+                faceNormals.push_back(n / length);
+                normals += n / length;
+            }
+        }
+        float axisLength = glm::length(normals);
+        meshlet.coneAxis = axisLength > 0.0f ? normals / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+        for (const glm::vec3 &n : faceNormals)
+            minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+        // cones wider than ~84 degrees reject next to nothing, don't spend the test on them
+        meshlet.coneCutoff = minDot < 0.1f ? 2.0f : sqrtf(1.0f - minDot * minDot);
+        meshlets.push_back(meshlet);
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        unsigned int id = (unsigned int)meshlets.size();
+        unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        unsigned int added = (owner[a] != id) + (owner[b] != id && b != a) + (owner[c] != id && c != a && c != b);
+        if (i > first && (vertexCount + added > maxVertices || (i - first) / 3 >= maxTriangles))
+        {
+            finish(i);
+            first = i;
+            vertexCount = 0;
+            id = (unsigned int)meshlets.size();
+        }
+        for (int k = 0; k < 3; k++)
+            if (owner[indices[i + k]] != id)
+            {
+                owner[indices[i + k]] = id;
+                vertexCount++;
+            }
+    }
+    if (indexCount >= first + 3)
+        finish(indexCount / 3 * 3);
+    return meshlets;
+}
+
+// runs all three passes; before/after are the simulated cache statistics of the input and the result
+void optimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices, VertexCacheStats &before, VertexCacheStats &after)
+{
+    before = analyzeVertexCache(indices, vertices.size());
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices);
+    optimizeVertexFetch(vertices, indices);
+    after = analyzeVertexCache(indices, vertices.size());
+}
+#endif
@@ -10,94 +10,472 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/gl_state.h>
+#include <learnopengl/gltf_loader.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/obj_loader.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/startup_profiler.h>
+#include <learnopengl/tangent_space.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/vfs_io_system.h>
 
+#include <strings.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+// post-processing applied by Assimp on import; part of the mesh cache key
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// optional processing after the import. The result is stored in the mesh cache, so it only runs on a cold load.
+struct ModelOptions {
+    bool weldVertices = false;   // merge duplicated vertices (mesh_optimizer.h)
+    bool optimizeMeshes = false; // vertex cache, overdraw and vertex fetch reordering (mesh_optimizer.h)
+    VertexFormat vertexFormat = VERTEX_FORMAT_FLOAT; // GPU layout, the cache stores the vertices in it
+    bool sharedBuffers = false;  // all meshes in one VBO/EBO/VAO (GeometryPool), applied at upload only
+    // coarser levels of detail generated per mesh (simplifyMesh), each with about half the triangles of the previous one
+    unsigned int lodLevels = 0;
+    // level selection in Model::PrepareDraw: largest tolerated error on screen and the band around it that
+    // has to be crossed before the level changes (fraction of lodErrorPixels)
+    float lodErrorPixels = 1.0f;
+    float lodHysteresis = 0.25f;
+    // split level 0 of every mesh into meshlets (buildMeshlets) that PrepareDraw culls against frustum and view direction
+    bool buildMeshlets = false;
+    // CPU copies of the geometry after upload (Mesh::releaseGeometry); only affects cold loads, warm loads never copy it
+    GeometryRetention geometryRetention = GEOMETRY_KEEP;
+    // normals and tangents from generateTangentSpace (tangent_space.h) instead of Assimp's post-processing
+    bool nativeTangentSpace = false;
+    // .obj files are read by ObjLoader (obj_loader.h) instead of Assimp, with native normals and tangents
+    bool nativeObjLoader = false;
+
+    // Assimp post-processing for these options
+    unsigned int importFlags() const
+    {
+        if (nativeTangentSpace)
+            return MODEL_IMPORT_FLAGS & ~(aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+        return MODEL_IMPORT_FLAGS;
+    }
 
+    // bits that select the matching mesh cache file
+    unsigned int cacheFlags() const
+    {
+        return (optimizeMeshes ? 1u : 0u) | (weldVertices ? 2u : 0u) | (std::min(lodLevels, 7u) << 2) | (buildMeshlets ? 32u : 0u) |
+               (nativeTangentSpace ? 64u : 0u) | (nativeObjLoader ? 128u : 0u) | (vertexFormat == VERTEX_FORMAT_PACKED ? 256u : 0u);
+    }
+};
 
+// CPU side result of importing a model file. Model::import produces it without touching OpenGL, so it can run
+// on a worker thread (see ModelLoader); the Model constructor turns it into GL objects on the context thread.
+struct ModelData {
+    string path;
+    ModelOptions options;
+    bool valid = false;
+    unique_ptr<MeshCache> cache; // warm load: the meshes are used straight from the mapped cache file
+    vector<MeshData> meshes;     // cold load
+    unique_ptr<GltfAsset> gltf;  // glTF: geometry is uploaded in place from the mapped file, nothing above is used
+    double importMs = 0.0;
+    // processing statistics of a cold load
+    VertexCacheStats cacheStatsBefore, cacheStatsAfter;
+    size_t verticesBeforeWeld = 0, verticesAfterWeld = 0;
+    vector<size_t> lodTriangles; // triangles per level of detail over all meshes
+    // per level: meshes that have it and their triangles one level up, for the reduction the level achieved
+    vector<size_t> lodMeshes, lodSourceTriangles;
+};
 
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    string path;
     string directory;
     bool gammaCorrection;
+    ModelOptions options;
+    shared_ptr<GeometryPool> geometryPool; // set with ModelOptions::sharedBuffers
+    vector<unsigned int> buffers;          // GL buffers of a glTF model, shared by its meshes
+    // load statistics, so cold (Assimp) and warm (mesh cache) starts can be compared
+    bool loadedFromCache = false;
+    double loadTimeMs = 0.0;
+    // meshlets of the drawn meshes and how many of them survived culling in the last PrepareDraw
+    size_t meshletsTotal = 0, meshletsVisible = 0;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, ModelOptions options = ModelOptions()) : gammaCorrection(gamma), options(options)
     {
-        loadModel(path);
+        ModelData data = import(path, options);
+        create(data);
+    }
+
+    // creates the GL objects of a model imported with Model::import, on the thread that owns the GL context
+    explicit Model(ModelData &data, bool gamma = false) : gammaCorrection(gamma), options(data.options)
+    {
+        create(data);
+    }
+
+    // reads a model with supported ASSIMP extensions, or its mesh cache, and runs all the CPU side processing.
+    // Doesn't touch OpenGL, so it's safe to call from worker threads. readCache = false forces an Assimp import,
+    // e.g. when a file the cache can't check (the .mtl) changed.
+    static ModelData import(string const &path, const ModelOptions &options, bool readCache = true)
+    {
+        ScopedTimer timer("model import", Vfs::get().relativeName(path));
+        auto start = chrono::steady_clock::now();
+        ModelData data;
+        data.path = path;
+        data.options = options;
+
+        // glTF is drawn from its own buffers, there's nothing to cache or process
+        if (GltfAsset::isGltf(path))
+        {
+            unique_ptr<GltfAsset> gltf(new GltfAsset());
+            string error;
+            if (gltf->load(path, error))
+            {
+                data.gltf = std::move(gltf);
+                data.valid = true;
+                data.importMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                return data;
+            }
+            cout << "WARNING::GLTF:: " << path << ": " << error << ", importing with Assimp" << endl;
+        }
+
+        unique_ptr<MeshCache> cache(new MeshCache());
+        if (readCache && cache->open(path, options.importFlags(), options.cacheFlags(), options.vertexFormat))
+            data.cache = std::move(cache);
+        else
+        {
+            bool obj = options.nativeObjLoader && path.size() >= 4 && strcasecmp(path.c_str() + path.size() - 4, ".obj") == 0;
+            if (!(obj ? importObj(path, data) : importAssimp(path, data)))
+                return data;
+            if (!MeshCache::write(path, options.importFlags(), options.cacheFlags(), options.vertexFormat, data.meshes))
+                cout << "WARNING::MESH_CACHE:: could not write cache for " << path << endl;
+        }
+        data.valid = true;
+        data.importMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return data;
     }
 
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        if (geometryPool)
+        {
+            // one VAO for the whole model
+            GLState::get().bindVertexArray(geometryPool->VAO);
+            for(unsigned int i = 0; i < meshes.size(); i++)
+                meshes[i].DrawBound(shader);
+            return;
+        }
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
 
+    // Prepares the following Draw calls (perspective projection):
+    // - meshes outside the view frustum are skipped
+    // - the level of detail is the coarsest one whose error, projected to the screen at the distance of the
+    //   mesh, stays below options.lodErrorPixels. A level only changes once its error crosses the threshold by
+    //   the hysteresis band, so meshes near the switching distance don't flicker between two levels.
+    // - at level 0, meshlets outside the frustum or facing away from the camera are culled. Which side faces
+    //   away follows the cull face and front face the model is drawn with; GL_NONE draws both sides.
+    // The culled meshlets hold for the next draw of each mesh only.
+    void PrepareDraw(const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &projection, float viewportHeight,
+                     GLenum cullFace = GL_BACK, GLenum frontFace = GL_CCW)
+    {
+        glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+        glm::vec3 cameraInModel = glm::vec3(glm::inverse(view * model)[3]);
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f; // at distance 1
+        float refine = options.lodErrorPixels * (1.0f + options.lodHysteresis);
+        float coarsen = options.lodErrorPixels * (1.0f - options.lodHysteresis);
+
+        // frustum planes in model space (Gribb/Hartmann), pointing inwards
+        glm::mat4 clip = projection * view * model;
+        glm::vec4 rows[4];
+        for (int r = 0; r < 4; r++)
+            rows[r] = glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+        glm::vec4 planes[6] = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]};
+        for (glm::vec4 &plane : planes)
+            plane = plane / glm::length(glm::vec3(plane));
+
+        // winding of the triangles the draw keeps, a mirroring transform flips it
+        float facing = cullFace == GL_NONE ? 0.0f : (cullFace == GL_BACK) == (frontFace == GL_CCW) ? 1.0f : -1.0f;
+        if (glm::determinant(glm::mat3(model)) < 0.0f)
+            facing = -facing;
+
+        meshletsTotal = meshletsVisible = 0;
+        for (Mesh &mesh : meshes)
+        {
+            mesh.visible = true;
+            for (int p = 0; p < 6 && mesh.visible; p++)
+                mesh.visible = glm::dot(glm::vec3(planes[p]), mesh.boundsCenter) + planes[p].w > -mesh.boundsRadius;
+            if (!mesh.visible)
+                continue;
+
+            if (mesh.lods.size() > 1)
+            {
+                glm::vec3 center = glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f));
+                float distance = std::max(glm::length(center - cameraPosition) - mesh.boundsRadius * scale, 1e-3f);
+                float pixelsPerError = scale * pixelsPerUnit / distance;
+                unsigned int level = std::min(mesh.currentLod, (unsigned int)mesh.lods.size() - 1);
+                while (level > 0 && mesh.lods[level].error * pixelsPerError > refine)
+                    level--;
+                while (level + 1 < mesh.lods.size() && mesh.lods[level + 1].error * pixelsPerError < coarsen)
+                    level++;
+                mesh.currentLod = level;
+            }
+
+            if (mesh.currentLod == 0 && !mesh.meshlets.empty())
+            {
+                meshletsTotal += mesh.meshlets.size();
+                meshletsVisible += mesh.cullMeshlets(planes, cameraInModel, facing);
+            }
+        }
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
+        textureNamePrefix = prefix;
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetTextureNamePrefix(prefix);
         }
     }
+
+    // deletes the GL buffers of all meshes; textures are released with their handles
+    void Release()
+    {
+        for (Mesh &mesh : meshes)
+            mesh.release();
+        if (geometryPool)
+            geometryPool->release();
+        if (!buffers.empty())
+            glDeleteBuffers((GLsizei)buffers.size(), buffers.data());
+        meshes.clear();
+        geometryPool.reset();
+        buffers.clear();
+    }
+
+    // hot reload: takes over a freshly created model of the same file, keeping the texture name prefix.
+    // The old buffers are deleted, so call between frames on the GL thread.
+    void Replace(Model &&fresh)
+    {
+        string prefix = textureNamePrefix;
+        Release();
+        *this = std::move(fresh);
+        SetShaderTextureNamePrefix(prefix);
+    }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    string textureNamePrefix;
+
+    // creates meshes, buffers and textures from imported data
+    void create(ModelData &data)
+    {
+        ScopedTimer timer("model create", Vfs::get().relativeName(data.path));
+        auto start = chrono::steady_clock::now();
+        path = data.path;
+        // retrieve the directory path of the filepath
+        directory = data.path.substr(0, data.path.find_last_of('/'));
+        loadedFromCache = data.cache != nullptr;
+        if (!data.valid)
+            return;
+        if (data.gltf)
+        {
+            // vertex layout straight from the accessors; the ModelOptions processing doesn't apply
+            buffers = data.gltf->upload();
+            meshes.reserve(data.gltf->primitives.size());
+            for (const GltfPrimitive &primitive : data.gltf->primitives)
+                meshes.push_back(Mesh(primitive.attributes, primitive.indexBuffer, primitive.indexOffset, primitive.indexCount, primitive.indexType,
+                                      primitive.boundsMin, primitive.boundsMax, loadTextures(primitive.textures)));
+            data.gltf.reset();
+            loadTimeMs = data.importMs + chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << "Model loaded (glTF) " << data.path << ": " << loadTimeMs << " ms" << endl;
+            return;
+        }
+        if (options.sharedBuffers)
+        {
+            // sized for all meshes up front, each mesh is then uploaded into its place as it is created
+            size_t vertexCount = 0, indexBytes = 0;
+            if (data.cache)
+                for (const CachedMesh &cached : data.cache->meshes)
+                {
+                    vertexCount += cached.vertexCount;
+                    indexBytes += GeometryPool::indexSpace(cached.indexCount * indexTypeSize(cached.indexType));
+                }
+            else
+                for (const MeshData &mesh : data.meshes)
+                {
+                    vertexCount += mesh.vertices.size();
+                    indexBytes += GeometryPool::indexSpace(mesh.indexCount() * mesh.indexSize());
+                }
+            geometryPool = make_shared<GeometryPool>(options.vertexFormat);
+            geometryPool->allocate(vertexCount, indexBytes);
+        }
+
+        if (data.cache)
+        {
+            // straight from the memory-mapped mesh cache, Assimp was not involved at all
+            meshes.reserve(data.cache->meshes.size());
+            for (const CachedMesh &cached : data.cache->meshes)
+            {
+                meshes.push_back(Mesh(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount, cached.indexType, cached.bounds,
+                                      loadTextures(cached.textures), options.vertexFormat, geometryPool.get(), cached.lods, cached.meshlets));
+                meshes.back().releaseGeometry(options.geometryRetention);
+            }
+            data.cache->close();
+        }
+        else
+        {
+            // uploaded from the imported arrays, which then move into the meshes if they are kept
+            meshes.reserve(data.meshes.size());
+            for (MeshData &mesh : data.meshes)
+            {
+                meshes.push_back(Mesh(mesh.vertexData(), (unsigned int)mesh.vertices.size(), mesh.indexData(), (unsigned int)mesh.indexCount(),
+                                      mesh.indexType, mesh.bounds, loadTextures(mesh.textures), options.vertexFormat, geometryPool.get(),
+                                      std::move(mesh.lods), std::move(mesh.meshlets)));
+                if (options.geometryRetention == GEOMETRY_KEEP)
+                {
+                    meshes.back().vertices = std::move(mesh.vertices);
+                    meshes.back().indices = std::move(mesh.indices);
+                    meshes.back().shortIndices = std::move(mesh.shortIndices);
+                }
+                meshes.back().releaseGeometry(options.geometryRetention);
+            }
+
+            if (options.weldVertices)
+                cout << "Vertex welding " << data.path << ": " << data.verticesBeforeWeld << " -> " << data.verticesAfterWeld << " vertices" << endl;
+            if (options.optimizeMeshes)
+                cout << "Mesh optimization " << data.path << ": ACMR " << data.cacheStatsBefore.acmr() << " -> " << data.cacheStatsAfter.acmr()
+                     << ", ATVR " << data.cacheStatsBefore.atvr() << " -> " << data.cacheStatsAfter.atvr() << endl;
+            if (options.lodLevels > 0)
+            {
+                // level: triangles (percent of the level above over the same meshes, meshes that have the level)
+                cout << "LOD triangles " << data.path << ":";
+                for (size_t level = 0; level < data.lodTriangles.size(); level++)
+                {
+                    cout << (level ? " / " : " ") << data.lodTriangles[level];
+                    if (level > 0 && data.lodSourceTriangles[level] > 0)
+                        cout << " (" << data.lodTriangles[level] * 100 / data.lodSourceTriangles[level] << "%, " << data.lodMeshes[level] << "/"
+                             << data.lodMeshes[0] << " meshes)";
+                }
+                cout << endl;
+            }
+        }
+
+        loadTimeMs = data.importMs + chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Model loaded (" << (loadedFromCache ? "warm" : "cold") << ") " << data.path << ": " << loadTimeMs << " ms" << endl;
+    }
+
+    static bool importAssimp(string const &path, ModelData &data)
     {
-        // read file via ASSIMP
+        // read file via ASSIMP, through the Vfs so packed models are parsed from the archive
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        importer.SetIOHandler(new VfsIOSystem()); // the importer owns and deletes it
+        const aiScene* scene = importer.ReadFile(path, data.options.importFlags());
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        // process ASSIMP's root node recursively, then the meshes in parallel
+        vector<aiMesh *> meshes;
+        processNode(scene->mRootNode, scene, meshes);
+        data.meshes.resize(meshes.size());
+        processInParallel(meshes.size(), data, [&](size_t i, ModelData &stats) {
+            data.meshes[i] = processMesh(meshes[i], scene, stats);
+        });
+        return true;
+    }
+
+    static bool importObj(string const &path, ModelData &data)
+    {
+        vector<ObjMesh> objMeshes;
+        string error;
+        if (!ObjLoader::load(path, objMeshes, error))
+        {
+            cout << "ERROR::OBJ_LOADER:: " << error << endl;
+            return false;
+        }
+        data.meshes.resize(objMeshes.size());
+        processInParallel(objMeshes.size(), data, [&](size_t i, ModelData &stats) {
+            data.meshes[i] = std::move(objMeshes[i].data);
+            processGeometry(data.meshes[i], true, true, !objMeshes[i].hasNormals, stats);
+        });
+        return true;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, vector<aiMesh *> &meshes)
     {
-        // process each mesh located at the current node
+        // collect each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // runs process(i, stats) for every mesh on the thread pool, one mesh per job; the statistics are gathered per
+    // mesh and summed afterwards in mesh order
+    static void processInParallel(size_t count, ModelData &data, const function<void(size_t, ModelData &)> &process)
     {
+        vector<ModelData> perMesh(count);
+        ThreadPool::shared().parallelFor(count, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                perMesh[i].options = data.options;
+                process(i, perMesh[i]);
+            }
+        });
+        for (const ModelData &stats : perMesh)
+        {
+            data.verticesBeforeWeld += stats.verticesBeforeWeld;
+            data.verticesAfterWeld += stats.verticesAfterWeld;
+            data.cacheStatsBefore.add(stats.cacheStatsBefore);
+            data.cacheStatsAfter.add(stats.cacheStatsAfter);
+            addPerLevel(data.lodTriangles, stats.lodTriangles);
+            addPerLevel(data.lodMeshes, stats.lodMeshes);
+            addPerLevel(data.lodSourceTriangles, stats.lodSourceTriangles);
+        }
+    }
+
+    static void addPerLevel(vector<size_t> &total, const vector<size_t> &counts)
+    {
+        if (total.size() < counts.size())
+            total.resize(counts.size(), 0);
+        for (size_t l = 0; l < counts.size(); l++)
+            total[l] += counts[l];
+    }
+
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene, ModelData &data)
+    {
+        const ModelOptions &options = data.options;
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData result;
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+        vector<CachedTexture> &textures = result.textures;
 
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve((size_t)mesh->mNumFaces * 3);
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
@@ -109,6 +487,7 @@ private:
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
             // normals
+            vertex.Normal = glm::vec3(0.0f);
             if (mesh->HasNormals())
             {
                 vector.x = mesh->mNormals[i].x;
@@ -125,6 +504,11 @@ private:
                 vec.x = mesh->mTextureCoords[0][i].x;
                 vec.y = mesh->mTextureCoords[0][i].y;
                 vertex.TexCoords = vec;
+            }
+            else
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            if (mesh->HasTangentsAndBitangents())
+            {
                 // tangent
                 vector.x = mesh->mTangents[i].x;
                 vector.y = mesh->mTangents[i].y;
@@ -136,8 +520,6 @@ private:
                 vector.z = mesh->mBitangents[i].z;
                 vertex.Bitangent = vector;
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
 
             vertices.push_back(vertex);
 
@@ -151,6 +533,9 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // the passes assume a pure triangle list, meshes with points or lines are left alone
+        bool triangles = mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+        processGeometry(result, triangles, options.nativeTangentSpace, !mesh->HasNormals(), data);
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -164,96 +549,133 @@ private:
 
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<CachedTexture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<CachedTexture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<CachedTexture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<CachedTexture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, the GL objects are created later on the context thread
+        return result;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // tangent space, welding, optimization, levels of detail and meshlets as selected by the options
+    static void processGeometry(MeshData &result, bool triangles, bool tangentSpace, bool generateNormals, ModelData &data)
     {
-        vector<Texture> textures;
+        const ModelOptions &options = data.options;
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+        if (tangentSpace && triangles)
+            generateTangentSpace(vertices, indices, generateNormals);
+        if (options.weldVertices)
+        {
+            data.verticesBeforeWeld += vertices.size();
+            weldVertices(vertices, indices);
+            data.verticesAfterWeld += vertices.size();
+        }
+        if (options.optimizeMeshes && triangles)
+        {
+            VertexCacheStats before, after;
+            optimizeMesh(vertices, indices, before, after);
+            data.cacheStatsBefore.add(before);
+            data.cacheStatsAfter.add(after);
+        }
+        if (options.lodLevels > 0 && triangles)
+            result.lods = buildLods(vertices, indices, data);
+        if (options.buildMeshlets && triangles)
+            result.meshlets = buildMeshlets(vertices, indices, result.lods.empty() ? indices.size() : result.lods[0].indexCount);
+        // the vertex count is final now: 16 bit indices where they fit, so the cache and the GPU get half the index data
+        if (vertices.size() < 65536)
+        {
+            result.shortIndices.assign(indices.begin(), indices.end());
+            vector<unsigned int>().swap(indices);
+            result.indexType = GL_UNSIGNED_SHORT;
+        }
+        // bounds and the GPU layout, cached so that no load has to go over the vertices again
+        result.vertexFormat = options.vertexFormat;
+        result.bounds = computeBounds(vertices.data(), vertices.size(), options.vertexFormat);
+        if (options.vertexFormat == VERTEX_FORMAT_PACKED)
+        {
+            result.packedVertices.resize(vertices.size());
+            packVertices(vertices.data(), vertices.size(), result.packedVertices.data(), result.bounds.positionOffset, result.bounds.positionScale);
+        }
+    }
+
+    // appends options.lodLevels simplified index lists to indices, each level is simplified from the previous one.
+    // The chain stops early once a mesh can't be reduced much further (open borders, positions shared by more than two vertices).
+    static vector<MeshLod> buildLods(const vector<Vertex> &vertices, vector<unsigned int> &indices, ModelData &data)
+    {
+        vector<MeshLod> lods;
+        lods.push_back({0, (unsigned int)indices.size(), 0.0f});
+        vector<unsigned int> level(indices), lodIndices;
+        float error = 0.0f;
+        for (unsigned int i = 0; i < data.options.lodLevels; i++)
+        {
+            float levelError;
+            vector<unsigned int> next = simplifyMesh(vertices, level, level.size() / 6 * 3, levelError);
+            if (next.empty() || next.size() * 10 > level.size() * 9)
+                break;
+            if (data.options.optimizeMeshes)
+                optimizeVertexCache(next, vertices.size());
+            error += levelError; // the quadrics restart per level, so the errors of the chain add up
+            lods.push_back({(unsigned int)(indices.size() + lodIndices.size()), (unsigned int)next.size(), error});
+            lodIndices.insert(lodIndices.end(), next.begin(), next.end());
+            level.swap(next);
+        }
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+
+        vector<size_t> triangles(lods.size()), meshes(lods.size(), 1), source(lods.size(), 0);
+        for (size_t l = 0; l < lods.size(); l++)
+        {
+            triangles[l] = lods[l].indexCount / 3;
+            if (l > 0)
+                source[l] = lods[l - 1].indexCount / 3;
+        }
+        addPerLevel(data.lodTriangles, triangles);
+        addPerLevel(data.lodMeshes, meshes);
+        addPerLevel(data.lodSourceTriangles, source);
+        return lods;
+    }
+
+    // collects the references of all material textures of a given type, the textures are loaded in create().
+    static vector<CachedTexture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    {
+        vector<CachedTexture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back({typeName, str.C_Str()});
         }
         return textures;
     }
-};
-
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    vector<Texture> loadTextures(const vector<CachedTexture> &references)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        vector<Texture> textures;
+        for (const CachedTexture &reference : references)
+            textures.push_back(loadTexture(reference.path.c_str(), reference.type));
+        return textures;
     }
-    else
+
+    // gets the texture at path (relative to the model directory) from the process-wide registry, which only
+    // loads it if no model (or main) holds a texture with the same contents already.
+    Texture loadTexture(const char *path, const string &typeName)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        Texture texture;
+        texture.handle = TextureRegistry::get().acquire(directory + '/' + path);
+        texture.id = texture.handle.id();
+        texture.type = typeName;
+        texture.path = path;
+        return texture;
     }
-
-    return textureID;
-}
+};
 #endif
@@ -0,0 +1,62 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/thread_pool.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Loads several models at once. Parsing and all CPU side processing (Model::import) run on the shared thread
+// pool, one job per model; the calling thread, which owns the GL context, creates the buffers and textures of
+// every model as soon as its import lands in the completion queue. Startup then takes about as long as the
+// largest model instead of the sum of all of them.
+class ModelLoader
+{
+public:
+    // the returned models are in the order of paths
+    static vector<unique_ptr<Model>> load(const vector<string> &paths, const ModelOptions &options = ModelOptions(), bool gamma = false)
+    {
+        auto start = chrono::steady_clock::now();
+        vector<ModelData> imported(paths.size());
+        mutex completedMutex;
+        condition_variable completedSignal;
+        deque<size_t> completed;
+
+        for (size_t i = 0; i < paths.size(); i++)
+            ThreadPool::shared().enqueue([&, i] {
+                ModelData data = Model::import(paths[i], options);
+                lock_guard<mutex> lock(completedMutex);
+                imported[i] = std::move(data);
+                completed.push_back(i);
+                completedSignal.notify_one();
+            });
+
+        vector<unique_ptr<Model>> models(paths.size());
+        for (size_t remaining = paths.size(); remaining > 0; remaining--)
+        {
+            size_t i;
+            {
+                unique_lock<mutex> lock(completedMutex);
+                completedSignal.wait(lock, [&] { return !completed.empty(); });
+                i = completed.front();
+                completed.pop_front();
+            }
+            // imported[i] is no longer touched by its worker once it is in the queue
+            models[i].reset(new Model(imported[i], gamma));
+            imported[i] = ModelData();
+        }
+
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Models loaded: " << paths.size() << " in " << ms << " ms" << endl;
+        return models;
+    }
+};
+#endif
@@ -0,0 +1,569 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Wavefront OBJ/MTL reader used by Model::import instead of Assimp (ModelOptions::nativeObjLoader).
+//
+// The file is mapped (or taken from the mounted archive) and split into chunks that end on a line break.
+// Every chunk is parsed on the thread pool into its own position, texture coordinate, normal and face arrays;
+// after the counts are summed up the faces of all chunks are written in parallel straight into the Vertex and
+// index arrays of the meshes. The output matches an Assimp import with aiProcess_Triangulate | aiProcess_FlipUVs:
+// one mesh per run of faces with the same material inside an object or group, one vertex per face corner,
+// polygons split into triangle fans. Normals and tangents are not part of it (see generateTangentSpace).
+//
+// Not supported: points, lines, free-form geometry and vertex colors; those lines are skipped.
+
+const size_t OBJ_MIN_CHUNK_SIZE = 256 * 1024;
+
+struct ObjMesh {
+    MeshData data;
+    bool hasNormals = true; // false if any corner had no normal index
+};
+
+// parses a float as written in OBJ files: optional sign, digits, fraction and exponent. Returns the position
+// after the number, or s if there is none.
+inline const char *parseObjFloat(const char *s, const char *end, float &value)
+{
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+                                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *p = s;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    bool any = false;
+    for (; p < end && (unsigned)(*p - '0') < 10; p++, any = true)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++, any = true)
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+    }
+    if (!any)
+        return s;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        if (q < end && (unsigned)(*q - '0') < 10)
+        {
+            int e = 0;
+            for (; q < end && (unsigned)(*q - '0') < 10; q++)
+                e = std::min(e * 10 + (*q - '0'), 10000);
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+    double result = (double)mantissa;
+    if (exponent < 0)
+        result = exponent >= -22 ? result / powers[-exponent] : result * std::pow(10.0, exponent);
+    else if (exponent > 0)
+        result = exponent <= 22 ? result * powers[exponent] : result * std::pow(10.0, exponent);
+    value = (float)(negative ? -result : result);
+    return p;
+}
+
+inline const char *parseObjInt(const char *s, const char *end, int64_t &value)
+{
+    const char *p = s;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    int64_t result = 0;
+    const char *digits = p;
+    for (; p < end && (unsigned)(*p - '0') < 10; p++)
+        result = result * 10 + (*p - '0');
+    if (p == digits)
+        return s;
+    value = negative ? -result : result;
+    return p;
+}
+
+class ObjLoader
+{
+public:
+    // reads path and the material libraries it names; false (and error set) if the file can't be read or a
+    // face refers to a vertex that doesn't exist
+    static bool load(const string &path, vector<ObjMesh> &meshes, string &error)
+    {
+        meshes.clear();
+        MappedFile file;
+        if (!file.open(path))
+        {
+            error = "could not read " + path;
+            return false;
+        }
+        const char *begin = (const char *)file.data, *end = begin + file.size;
+
+        // chunks end after a line break
+        ThreadPool &pool = ThreadPool::shared();
+        size_t chunkSize = std::max(OBJ_MIN_CHUNK_SIZE, file.size / (4 * std::max(1u, pool.size()) + 1));
+        vector<const char *> bounds(1, begin);
+        while (bounds.back() < end)
+        {
+            const char *next = bounds.back() + std::min(chunkSize, (size_t)(end - bounds.back()));
+            while (next < end && next[-1] != '\n')
+                next++;
+            bounds.push_back(next);
+        }
+        size_t chunkCount = bounds.size() - 1;
+
+        // pass 1: parse every chunk on its own
+        vector<Chunk> chunks(chunkCount);
+        pool.parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++)
+                parseChunk(bounds[c], bounds[c + 1], chunks[c]);
+        });
+
+        // element offsets of the chunks, then everything in one array each
+        size_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+        for (Chunk &chunk : chunks)
+        {
+            chunk.positionBase = positionCount;
+            chunk.texCoordBase = texCoordCount;
+            chunk.normalBase = normalCount;
+            positionCount += chunk.positions.size() / 3;
+            texCoordCount += chunk.texCoords.size() / 2;
+            normalCount += chunk.normals.size() / 3;
+        }
+        vector<float> positions(positionCount * 3), texCoords(texCoordCount * 2), normals(normalCount * 3);
+        pool.parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++)
+            {
+                const Chunk &chunk = chunks[c];
+                std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+                std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordBase * 2);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+            }
+        });
+
+        // materials of all libraries, later definitions of a name win like in Assimp
+        map<string, vector<CachedTexture>> materials;
+        string directory = path.substr(0, path.find_last_of('/') + 1);
+        for (const Chunk &chunk : chunks)
+            for (const string &library : chunk.libraries)
+                loadMaterials(directory + library, materials);
+
+        // assign the runs of faces to meshes: a new mesh starts at every usemtl, o and g
+        vector<Segment> segments(1);
+        for (Chunk &chunk : chunks)
+            for (size_t r = 0; r < chunk.runs.size(); r++)
+            {
+                Run &run = chunk.runs[r];
+                if (r > 0)
+                {
+                    const Event &event = chunk.events[r - 1];
+                    Segment next;
+                    next.material = event.type == EVENT_MATERIAL ? event.name : segments.back().material;
+                    segments.push_back(next);
+                }
+                Segment &segment = segments.back();
+                run.segment = segments.size() - 1;
+                run.vertexOffset = segment.vertexCount;
+                run.indexOffset = segment.indexCount;
+                segment.vertexCount += run.cornerCount;
+                segment.indexCount += run.triangleCount * 3;
+                segment.hasNormals = segment.hasNormals && !run.missingNormals;
+            }
+        vector<MeshData> data(segments.size());
+        for (size_t s = 0; s < segments.size(); s++)
+        {
+            data[s].vertices.resize(segments[s].vertexCount);
+            data[s].indices.resize(segments[s].indexCount);
+        }
+
+        // pass 2: write the vertices and indices of all chunks in parallel
+        atomic<bool> badIndex{false};
+        pool.parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; c++)
+                if (!fillChunk(chunks[c], positions, texCoords, normals, data))
+                    badIndex = true;
+        });
+        if (badIndex)
+        {
+            error = path + ": face refers to a vertex that does not exist";
+            return false;
+        }
+
+        for (size_t s = 0; s < segments.size(); s++)
+        {
+            if (data[s].indices.empty())
+                continue;
+            ObjMesh mesh;
+            mesh.data = std::move(data[s]);
+            mesh.hasNormals = segments[s].hasNormals;
+            auto material = materials.find(segments[s].material);
+            if (material != materials.end())
+            {
+                mesh.data.textures = material->second;
+                std::stable_sort(mesh.data.textures.begin(), mesh.data.textures.end(), [](const CachedTexture &a, const CachedTexture &b) {
+                    return samplerRank(a.type) < samplerRank(b.type);
+                });
+            }
+            meshes.push_back(std::move(mesh));
+        }
+        if (meshes.empty())
+        {
+            error = path + ": no faces";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // index not given (e.g. f 1//2 has no texture coordinate)
+    static const int64_t MISSING = INT64_MIN;
+    // negative (relative) indices are resolved in pass 2 against the chunk's base: stored as the chunk local
+    // element index minus RELATIVE
+    static const int64_t RELATIVE = (int64_t)1 << 50;
+
+    enum EventType { EVENT_MATERIAL, EVENT_GROUP };
+
+    struct Event {
+        EventType type;
+        string name;
+    };
+
+    struct Corner {
+        int64_t position, texCoord, normal;
+    };
+
+    // faces of a chunk between two events
+    struct Run {
+        size_t firstFace = 0, faceCount = 0;
+        size_t firstCorner = 0, cornerCount = 0;
+        size_t triangleCount = 0;
+        bool missingNormals = false;
+        // set after pass 1
+        size_t segment = 0, vertexOffset = 0, indexOffset = 0;
+    };
+
+    struct Chunk {
+        vector<float> positions, texCoords, normals;
+        vector<Corner> corners;
+        vector<uint32_t> faceSizes;
+        vector<Event> events; // events[i] starts runs[i + 1]
+        vector<Run> runs;
+        vector<string> libraries;
+        size_t positionBase = 0, texCoordBase = 0, normalBase = 0;
+    };
+
+    struct Segment {
+        string material;
+        size_t vertexCount = 0, indexCount = 0;
+        bool hasNormals = true;
+    };
+
+    static bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char *skipBlanks(const char *p, const char *end)
+    {
+        while (p < end && isBlank(*p))
+            p++;
+        return p;
+    }
+
+    // the rest of the line without surrounding blanks
+    static string restOfLine(const char *p, const char *end)
+    {
+        p = skipBlanks(p, end);
+        const char *e = end;
+        while (e > p && isBlank(e[-1]))
+            e--;
+        return string(p, e);
+    }
+
+    static const char *parseFloats(const char *p, const char *end, vector<float> &out, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float value = 0.0f;
+            p = parseObjFloat(skipBlanks(p, end), end, value);
+            out.push_back(value);
+        }
+        return p;
+    }
+
+    // one index of a face corner, 1 based or negative (relative to the elements read so far)
+    static int64_t resolveIndex(int64_t index, size_t localCount)
+    {
+        if (index > 0)
+            return index - 1;
+        if (index < 0)
+            return (int64_t)localCount + index - RELATIVE;
+        return MISSING;
+    }
+
+    static void parseFace(const char *p, const char *end, Chunk &chunk, Run &run)
+    {
+        size_t first = chunk.corners.size();
+        for (;;)
+        {
+            p = skipBlanks(p, end);
+            if (p >= end)
+                break;
+            int64_t v = 0, t = 0, n = 0;
+            const char *q = parseObjInt(p, end, v);
+            if (q == p)
+                break;
+            p = q;
+            if (p < end && *p == '/')
+            {
+                p = parseObjInt(p + 1, end, t);
+                if (p < end && *p == '/')
+                    p = parseObjInt(p + 1, end, n);
+            }
+            Corner corner = {resolveIndex(v, chunk.positions.size() / 3), resolveIndex(t, chunk.texCoords.size() / 2),
+                             resolveIndex(n, chunk.normals.size() / 3)};
+            if (corner.normal == MISSING)
+                run.missingNormals = true;
+            chunk.corners.push_back(corner);
+            while (p < end && !isBlank(*p))
+                p++;
+        }
+        size_t size = chunk.corners.size() - first;
+        if (size < 3 || chunk.corners[first].position == MISSING)
+        {
+            chunk.corners.resize(first); // points and lines
+            return;
+        }
+        chunk.faceSizes.push_back((uint32_t)size);
+        run.faceCount++;
+        run.cornerCount += size;
+        run.triangleCount += size - 2;
+    }
+
+    static void parseChunk(const char *p, const char *end, Chunk &chunk)
+    {
+        // rough guess from the bytes, most lines are vertices
+        chunk.positions.reserve((size_t)(end - p) / 24);
+        chunk.runs.push_back(Run());
+        while (p < end)
+        {
+            const char *lineEnd = (const char *)memchr(p, '\n', (size_t)(end - p));
+            if (!lineEnd)
+                lineEnd = end;
+            const char *s = skipBlanks(p, lineEnd);
+            size_t length = (size_t)(lineEnd - s);
+            if (length >= 2 && s[0] == 'v' && isBlank(s[1]))
+                parseFloats(s + 2, lineEnd, chunk.positions, 3);
+            else if (length >= 3 && s[0] == 'v' && s[1] == 't' && isBlank(s[2]))
+                parseFloats(s + 3, lineEnd, chunk.texCoords, 2);
+            else if (length >= 3 && s[0] == 'v' && s[1] == 'n' && isBlank(s[2]))
+                parseFloats(s + 3, lineEnd, chunk.normals, 3);
+            else if (length >= 2 && s[0] == 'f' && isBlank(s[1]))
+                parseFace(s + 2, lineEnd, chunk, chunk.runs.back());
+            else if (length >= 7 && memcmp(s, "usemtl", 6) == 0 && isBlank(s[6]))
+                startRun(chunk, EVENT_MATERIAL, restOfLine(s + 7, lineEnd));
+            else if (length >= 1 && (s[0] == 'o' || s[0] == 'g') && (length == 1 || isBlank(s[1])))
+                startRun(chunk, EVENT_GROUP, "");
+            else if (length >= 7 && memcmp(s, "mtllib", 6) == 0 && isBlank(s[6]))
+                chunk.libraries.push_back(restOfLine(s + 7, lineEnd));
+            p = lineEnd + 1;
+        }
+    }
+
+    static void startRun(Chunk &chunk, EventType type, const string &name)
+    {
+        const Run &previous = chunk.runs.back();
+        Run run;
+        run.firstFace = previous.firstFace + previous.faceCount;
+        run.firstCorner = previous.firstCorner + previous.cornerCount;
+        chunk.events.push_back(Event{type, name});
+        chunk.runs.push_back(run);
+    }
+
+    static bool resolve(int64_t index, size_t base, size_t count, size_t &resolved)
+    {
+        if (index == MISSING)
+            return false;
+        int64_t absolute = index < 0 ? (int64_t)base + index + RELATIVE : index;
+        if (absolute < 0 || (size_t)absolute >= count)
+            return false;
+        resolved = (size_t)absolute;
+        return true;
+    }
+
+    static bool fillChunk(const Chunk &chunk, const vector<float> &positions, const vector<float> &texCoords,
+                          const vector<float> &normals, vector<MeshData> &meshes)
+    {
+        size_t positionCount = positions.size() / 3, texCoordCount = texCoords.size() / 2, normalCount = normals.size() / 3;
+        for (const Run &run : chunk.runs)
+        {
+            MeshData &mesh = meshes[run.segment];
+            Vertex *vertex = mesh.vertices.data() + run.vertexOffset;
+            unsigned int *index = mesh.indices.data() + run.indexOffset;
+            const Corner *corner = chunk.corners.data() + run.firstCorner;
+            unsigned int base = (unsigned int)run.vertexOffset;
+            for (size_t f = run.firstFace; f < run.firstFace + run.faceCount; f++)
+            {
+                uint32_t size = chunk.faceSizes[f];
+                for (uint32_t k = 0; k < size; k++, corner++, vertex++)
+                {
+                    size_t i;
+                    if (!resolve(corner->position, chunk.positionBase, positionCount, i))
+                        return false;
+                    vertex->Position = glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+                    if (resolve(corner->texCoord, chunk.texCoordBase, texCoordCount, i))
+                        vertex->TexCoords = glm::vec2(texCoords[i * 2], 1.0f - texCoords[i * 2 + 1]); // aiProcess_FlipUVs
+                    else
+                        vertex->TexCoords = glm::vec2(0.0f, 0.0f);
+                    if (resolve(corner->normal, chunk.normalBase, normalCount, i))
+                        vertex->Normal = glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+                    else
+                        vertex->Normal = glm::vec3(0.0f);
+                    vertex->Tangent = glm::vec3(0.0f);
+                    vertex->Bitangent = glm::vec3(0.0f);
+                }
+                // triangle fan, like aiProcess_Triangulate for convex polygons
+                for (uint32_t k = 1; k + 1 < size; k++)
+                {
+                    *index++ = base;
+                    *index++ = base + k;
+                    *index++ = base + k + 1;
+                }
+                base += size;
+            }
+        }
+        return true;
+    }
+
+    // texture map statements map to the sampler names Model::processMesh gives the Assimp texture types
+    static const char *samplerType(const string &keyword)
+    {
+        if (keyword == "map_Kd")
+            return "texture_diffuse";
+        if (keyword == "map_Ks")
+            return "texture_specular";
+        if (keyword == "map_bump" || keyword == "map_Bump" || keyword == "bump")
+            return "texture_normal"; // aiTextureType_HEIGHT
+        if (keyword == "map_Ka")
+            return "texture_height"; // aiTextureType_AMBIENT
+        return nullptr;
+    }
+
+    // file name of a map statement, after options such as -bm 0.5 or -s 1 1 1
+    static string mapFile(const string &arguments)
+    {
+        size_t p = 0;
+        auto nextToken = [&](string &token) {
+            while (p < arguments.size() && isBlank(arguments[p]))
+                p++;
+            size_t start = p;
+            while (p < arguments.size() && !isBlank(arguments[p]))
+                p++;
+            token = arguments.substr(start, p - start);
+        };
+        for (;;)
+        {
+            size_t start = p;
+            string option;
+            nextToken(option);
+            if (option.size() < 2 || option[0] != '-')
+            {
+                p = start;
+                break;
+            }
+            if (option == "-o" || option == "-s" || option == "-t")
+            {
+                // up to three numbers
+                for (int i = 0; i < 3; i++)
+                {
+                    size_t before = p;
+                    string value;
+                    nextToken(value);
+                    float number;
+                    if (value.empty() || parseObjFloat(value.c_str(), value.c_str() + value.size(), number) == value.c_str())
+                    {
+                        p = before;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                string value;
+                for (int i = option == "-mm" ? 2 : 1; i > 0; i--)
+                    nextToken(value);
+            }
+        }
+        return restOfLine(arguments.c_str() + p, arguments.c_str() + arguments.size());
+    }
+
+    // same texture order as Model::processMesh: diffuse, specular, normal, height
+    static int samplerRank(const string &type)
+    {
+        static const char *const order[] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+        for (int i = 0; i < 4; i++)
+            if (type == order[i])
+                return i;
+        return 4;
+    }
+
+    static void loadMaterials(const string &path, map<string, vector<CachedTexture>> &materials)
+    {
+        FileContents file;
+        if (!Vfs::get().read(path, file))
+            return;
+        const char *p = (const char *)file.data, *end = p + file.size;
+        vector<CachedTexture> *current = nullptr;
+        while (p < end)
+        {
+            const char *lineEnd = (const char *)memchr(p, '\n', (size_t)(end - p));
+            if (!lineEnd)
+                lineEnd = end;
+            string line = restOfLine(p, lineEnd);
+            p = lineEnd + 1;
+            size_t split = line.find_first_of(" \t");
+            if (split == string::npos)
+                continue;
+            string keyword = line.substr(0, split);
+            string arguments = restOfLine(line.c_str() + split, line.c_str() + line.size());
+            if (keyword == "newmtl")
+            {
+                current = &materials[arguments];
+                current->clear();
+            }
+            else if (const char *type = samplerType(keyword))
+            {
+                string texture = mapFile(arguments);
+                if (current && !texture.empty())
+                    current->push_back(CachedTexture{type, texture});
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,202 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/vfs.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// ARB_get_program_binary (core in 4.1), not part of the GL 3.3 loader
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// On-disk cache of linked shader programs (glGetProgramBinary/glProgramBinary). A program is keyed by a hash of
+// its vertex, fragment and geometry sources and of the vendor, renderer and version strings, so an edited
+// shader or a driver update simply misses. A miss, a binary the driver rejects or a driver without the
+// extension all fall back to compiling from source (Shader::build).
+//
+// File layout: ProgramCacheHeader | binary
+const uint32_t PROGRAM_CACHE_MAGIC   = 0x4d475250; // "PRGM"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+const char *const PROGRAM_CACHE_DIRECTORY = "resources/cache/programs"; // relative to the resource root (FileSystem::getPath)
+
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+class ProgramBinaryCache
+{
+public:
+    size_t hits = 0, misses = 0;
+
+    static ProgramBinaryCache &get()
+    {
+        static ProgramBinaryCache cache;
+        return cache;
+    }
+
+    // call once after GLAD is loaded, with the same loader (e.g. glfwGetProcAddress)
+    void init(GLADloadproc load)
+    {
+        enabled = false;
+        if (!hasExtension("GL_ARB_get_program_binary") && !isVersion41())
+            return;
+        getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+        programBinary = (ProgramBinaryProc)load("glProgramBinary");
+        programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        enabled = getProgramBinary && programBinary && programParameteri && formats > 0;
+
+        driver = string((const char *)glGetString(GL_VENDOR)) + "\n" + (const char *)glGetString(GL_RENDERER) + "\n" +
+                 (const char *)glGetString(GL_VERSION);
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    uint64_t key(const string &vertexCode, const string &fragmentCode, const string &geometryCode) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        const string *parts[4] = {&vertexCode, &fragmentCode, &geometryCode, &driver};
+        for (const string *part : parts)
+        {
+            for (char c : *part)
+                hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+            hash = (hash ^ 0xff) * 1099511628211ull; // separator, "ab"+"c" != "a"+"bc"
+        }
+        return hash;
+    }
+
+    // loads the cached binary into program; false if there is none or the driver did not accept it
+    bool load(uint64_t key, unsigned int program)
+    {
+        if (!enabled)
+            return false;
+        FileContents file;
+        ProgramCacheHeader header;
+        if (!Vfs::get().read(fileFor(key), file) || file.size < sizeof(header))
+        {
+            misses++;
+            return false;
+        }
+        memcpy(&header, file.data, sizeof(header));
+        if (header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION || header.key != key ||
+            header.binaryLength != file.size - sizeof(header))
+        {
+            misses++;
+            return false;
+        }
+        programBinary(program, header.binaryFormat, file.data + sizeof(header), (GLsizei)header.binaryLength);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked)
+            hits++;
+        else
+            misses++;
+        return linked == GL_TRUE;
+    }
+
+    // before linking a program that will be stored
+    void prepare(unsigned int program)
+    {
+        if (enabled)
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // stores a successfully linked program, written under a temporary name and renamed into place
+    void store(uint64_t key, unsigned int program)
+    {
+        if (!enabled)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        vector<unsigned char> binary((size_t)length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        getProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return;
+
+        if (!FileSystem::createDirectories(FileSystem::getPath(PROGRAM_CACHE_DIRECTORY)))
+            return;
+        string path = fileFor(key);
+        string tmpPath = path + ".tmp";
+        ProgramCacheHeader header = {PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, format, (uint32_t)written};
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            out.write((const char *)&header, sizeof(header));
+            out.write((const char *)binary.data(), written);
+            if (!out)
+            {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return;
+            }
+        }
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+            std::remove(tmpPath.c_str());
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    bool enabled = false;
+    string driver;
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+
+    ProgramBinaryCache() {}
+
+    static bool isVersion41()
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        return major > 4 || (major == 4 && minor >= 1);
+    }
+
+    static bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+            if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i), name) == 0)
+                return true;
+        return false;
+    }
+
+    static string fileFor(uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+        return FileSystem::getPath(string(PROGRAM_CACHE_DIRECTORY) + "/" + name + ".bin");
+    }
+};
+#endif
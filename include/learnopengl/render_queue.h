@@ -0,0 +1,286 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Draws of a frame are pushed as packets and submitted sorted by a 64 bit key, so draws that share a program,
+// material and VAO run back to back and GL state only changes between groups. Key, from the top bit down:
+//   layer 2 | opaque, sky:  program 10 | cull 2 | material 14 | VAO 12 | depth 24 (front to back)
+//           | transparent: depth 24 (back to front) | program 10 | cull 2 | material 14 | VAO 12
+// Program and VAO are their GL names and the material is a hash of the textures. The fields only group equal
+// values: a collision can cost a state change, never a wrong one, submit compares the packets themselves.
+
+enum RenderLayer { RENDER_LAYER_OPAQUE = 0, RENDER_LAYER_SKY = 1, RENDER_LAYER_TRANSPARENT = 2 };
+enum RenderCull { RENDER_CULL_NONE = 0, RENDER_CULL_BACK = 1, RENDER_CULL_FRONT = 2 };
+
+const unsigned int RENDER_MAX_TEXTURES = 4;
+
+struct RenderPacket {
+    Shader *shader;
+    UniformHandle<glm::mat4> modelUniform;
+    glm::mat4 model;
+    unsigned int VAO;
+    RenderLayer layer;
+    RenderCull cull;
+    GLenum depthFunc = GL_LESS;
+    float depth; // view space distance of the packet's center
+    // material: textures on units 0..textureCount-1 (for a mesh the first RENDER_MAX_TEXTURES of its textures)
+    unsigned int textureCount = 0;
+    GLenum textureTargets[RENDER_MAX_TEXTURES];
+    unsigned int textures[RENDER_MAX_TEXTURES];
+    // geometry: a mesh (Mesh::DrawGeometry, its textures bound by Mesh::BindTextures) or glDrawArrays on VAO
+    Mesh *mesh = nullptr;
+    GLenum mode = GL_TRIANGLES;
+    GLint first = 0;
+    GLsizei count = 0;
+
+    RenderPacket &texture(unsigned int id, GLenum target = GL_TEXTURE_2D)
+    {
+        if (textureCount < RENDER_MAX_TEXTURES)
+        {
+            textureTargets[textureCount] = target;
+            textures[textureCount] = id;
+        }
+        textureCount++;
+        return *this;
+    }
+};
+
+// counters of the last RenderQueue::submit
+struct RenderQueueStats {
+    size_t packets = 0;
+    size_t drawCalls = 0;
+    size_t programChanges = 0;
+    size_t vaoChanges = 0;
+    size_t materialChanges = 0;
+    size_t renderStateChanges = 0; // cull mode and depth function
+    size_t textureBinds = 0;
+    // program, VAO, material and render state changes as submitted, and as the packets were pushed
+    size_t stateChanges = 0;
+    size_t unsortedStateChanges = 0;
+    double sortMs = 0.0;
+    double submitMs = 0.0; // CPU time of the GL calls of the draws
+};
+
+class RenderQueue
+{
+public:
+    // starts a frame: clears the packets; view and farPlane give the depth of the packets
+    void begin(const glm::mat4 &view, float farPlane)
+    {
+        this->view = view;
+        this->farPlane = farPlane;
+        packets.clear();
+    }
+
+    // glDrawArrays(mode, first, count) on VAO, textures are added to the returned packet
+    RenderPacket &addArrays(Shader &shader, UniformHandle<glm::mat4> modelUniform, const glm::mat4 &model, unsigned int VAO, GLenum mode,
+                            GLint first, GLsizei count, RenderLayer layer, RenderCull cull)
+    {
+        RenderPacket &packet = add(shader, modelUniform, model, glm::vec3(model[3]), layer, cull);
+        packet.VAO = VAO;
+        packet.mode = mode;
+        packet.first = first;
+        packet.count = count;
+        return packet;
+    }
+
+    // one packet per visible mesh of model (after Model::PrepareDraw)
+    void addModel(Shader &shader, UniformHandle<glm::mat4> modelUniform, Model &model, const glm::mat4 &transform, RenderLayer layer,
+                  RenderCull cull)
+    {
+        for (Mesh &mesh : model.meshes)
+        {
+            if (!mesh.visible)
+                continue;
+            RenderPacket &packet = add(shader, modelUniform, transform, glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f)), layer, cull);
+            packet.VAO = model.geometryPool ? model.geometryPool->VAO : mesh.VAO;
+            packet.mesh = &mesh;
+            for (size_t i = 0; i < mesh.textures.size(); i++)
+                packet.texture(mesh.textureId(i));
+        }
+    }
+
+    // sorts the packets and draws them, changing state through GLState. Afterwards the depth function is
+    // GL_LESS and back faces are culled.
+    void submit()
+    {
+        stats = RenderQueueStats();
+        stats.packets = packets.size();
+        auto start = chrono::steady_clock::now();
+        keys.resize(packets.size());
+        order.resize(packets.size());
+        for (size_t i = 0; i < packets.size(); i++)
+        {
+            keys[i] = key(packets[i]);
+            order[i] = (uint32_t)i;
+        }
+        radixSort();
+        for (size_t i = 1; i < packets.size(); i++)
+            stats.unsortedStateChanges += changes(packets[i - 1], packets[i]);
+        auto sorted = chrono::steady_clock::now();
+        stats.sortMs = chrono::duration<double, milli>(sorted - start).count();
+
+        GLState &gl = GLState::get();
+        const RenderPacket *previous = nullptr;
+        for (uint32_t index : order)
+        {
+            const RenderPacket &packet = packets[index];
+            bool programChanged = !previous || packet.shader->ID != previous->shader->ID;
+            if (programChanged)
+            {
+                packet.shader->use();
+                stats.programChanges++;
+            }
+            if (!previous || packet.cull != previous->cull)
+            {
+                gl.setCapability(GL_CULL_FACE, packet.cull != RENDER_CULL_NONE);
+                if (packet.cull != RENDER_CULL_NONE)
+                    gl.cullFace(packet.cull == RENDER_CULL_FRONT ? GL_FRONT : GL_BACK);
+                stats.renderStateChanges++;
+            }
+            if (!previous || packet.depthFunc != previous->depthFunc)
+            {
+                gl.depthFunc(packet.depthFunc);
+                stats.renderStateChanges++;
+            }
+            if (!previous || packet.VAO != previous->VAO)
+            {
+                gl.bindVertexArray(packet.VAO);
+                stats.vaoChanges++;
+            }
+            if (!previous || (packet.mesh && programChanged) || !sameTextures(packet, *previous))
+            {
+                bindMaterial(packet);
+                stats.materialChanges++;
+            }
+            packet.shader->set(packet.modelUniform, packet.model);
+            if (packet.mesh)
+                packet.mesh->DrawGeometry(*packet.shader);
+            else
+                glDrawArrays(packet.mode, packet.first, packet.count);
+            stats.drawCalls++;
+            previous = &packet;
+        }
+        gl.depthFunc(GL_LESS);
+        gl.enable(GL_CULL_FACE);
+        gl.cullFace(GL_BACK);
+        stats.stateChanges = stats.programChanges + stats.vaoChanges + stats.materialChanges + stats.renderStateChanges;
+        stats.submitMs = chrono::duration<double, milli>(chrono::steady_clock::now() - sorted).count();
+    }
+
+    const RenderQueueStats &getStats() const { return stats; }
+
+private:
+    vector<RenderPacket> packets;
+    // sort keys and packet indices, with the scratch of the radix sort; capacity stays between frames
+    vector<uint64_t> keys, scratchKeys;
+    vector<uint32_t> order, scratchOrder;
+    glm::mat4 view = glm::mat4(1.0f);
+    float farPlane = 100.0f;
+    RenderQueueStats stats;
+
+    RenderPacket &add(Shader &shader, UniformHandle<glm::mat4> modelUniform, const glm::mat4 &model, const glm::vec3 &center,
+                      RenderLayer layer, RenderCull cull)
+    {
+        packets.emplace_back();
+        RenderPacket &packet = packets.back();
+        packet.shader = &shader;
+        packet.modelUniform = modelUniform;
+        packet.model = model;
+        packet.VAO = 0;
+        packet.layer = layer;
+        packet.cull = cull;
+        packet.depth = -(view * glm::vec4(center, 1.0f)).z;
+        if (layer == RENDER_LAYER_SKY)
+            packet.depthFunc = GL_LEQUAL; // drawn at the far plane, passes where nothing else was drawn
+        return packet;
+    }
+
+    static bool sameTextures(const RenderPacket &a, const RenderPacket &b)
+    {
+        if (a.textureCount != b.textureCount || a.textureCount > RENDER_MAX_TEXTURES)
+            return false;
+        for (unsigned int i = 0; i < a.textureCount; i++)
+            if (a.textures[i] != b.textures[i] || a.textureTargets[i] != b.textureTargets[i])
+                return false;
+        return true;
+    }
+
+    // state changes between two consecutive packets, as counted by submit
+    static size_t changes(const RenderPacket &a, const RenderPacket &b)
+    {
+        bool programChanged = a.shader->ID != b.shader->ID;
+        return (programChanged ? 1 : 0) + (a.VAO != b.VAO ? 1 : 0) + (a.cull != b.cull ? 1 : 0) + (a.depthFunc != b.depthFunc ? 1 : 0) +
+               ((b.mesh && programChanged) || !sameTextures(a, b) ? 1 : 0);
+    }
+
+    // a mesh also points the samplers of the program at its units
+    void bindMaterial(const RenderPacket &packet)
+    {
+        if (packet.mesh)
+        {
+            packet.mesh->BindTextures(*packet.shader);
+            stats.textureBinds += packet.textureCount;
+            return;
+        }
+        for (unsigned int i = 0; i < packet.textureCount; i++)
+            GLState::get().bindTexture(i, packet.textureTargets[i], packet.textures[i]);
+        stats.textureBinds += packet.textureCount;
+    }
+
+    uint64_t key(const RenderPacket &packet) const
+    {
+        // FNV-1a over the texture names
+        uint32_t material = 2166136261u;
+        for (unsigned int i = 0; i < std::min(packet.textureCount, RENDER_MAX_TEXTURES); i++)
+            material = (material ^ packet.textures[i]) * 16777619u;
+        uint64_t state = ((uint64_t)(packet.shader->ID & 0x3ff) << 28) | ((uint64_t)packet.cull << 26) |
+                         ((uint64_t)(material & 0x3fff) << 12) | (uint64_t)(packet.VAO & 0xfff);
+        uint64_t depth = (uint64_t)(std::min(std::max(packet.depth / farPlane, 0.0f), 1.0f) * 0xffffff);
+        if (packet.layer == RENDER_LAYER_TRANSPARENT)
+            return ((uint64_t)packet.layer << 62) | ((0xffffff - depth) << 38) | state;
+        return ((uint64_t)packet.layer << 62) | (state << 24) | depth;
+    }
+
+    // LSD radix sort of keys (and order along), one pass per byte; stable, so equal keys keep their push order.
+    // Bytes that are the same in every key are skipped.
+    void radixSort()
+    {
+        size_t count = keys.size();
+        if (count < 2)
+            return;
+        scratchKeys.resize(count);
+        scratchOrder.resize(count);
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            size_t offsets[257] = {0};
+            for (size_t i = 0; i < count; i++)
+                offsets[((keys[i] >> shift) & 0xff) + 1]++;
+            if (offsets[((keys[0] >> shift) & 0xff) + 1] == count)
+                continue;
+            for (int digit = 0; digit < 256; digit++)
+                offsets[digit + 1] += offsets[digit];
+            for (size_t i = 0; i < count; i++)
+            {
+                size_t slot = offsets[(keys[i] >> shift) & 0xff]++;
+                scratchKeys[slot] = keys[i];
+                scratchOrder[slot] = order[i];
+            }
+            keys.swap(scratchKeys);
+            order.swap(scratchOrder);
+        }
+    }
+};
+#endif
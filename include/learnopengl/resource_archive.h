@@ -0,0 +1,222 @@
+#ifndef RESOURCE_ARCHIVE_H
+#define RESOURCE_ARCHIVE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Packed resource archive written by tools/pack_resources.cpp and read through the Vfs (vfs.h).
+// All files of a scene live in one file that is mapped once; a file is found by binary search over the
+// path hashes and handed out as a pointer into the mapping, nothing is copied.
+//
+// File layout:
+//   ArchiveHeader | file data (every file 16 byte aligned) | ArchiveEntry[entryCount] sorted by pathHash | names
+// Names are the normalized relative paths (see Vfs::normalize), e.g. resources/textures/window.png.
+
+const uint32_t ARCHIVE_MAGIC   = 0x4b415052; // "RPAK"
+const uint32_t ARCHIVE_VERSION = 1;
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t namesOffset;
+};
+
+struct ArchiveEntry {
+    uint64_t pathHash;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t nameOffset; // relative to namesOffset
+    uint32_t nameLength;
+};
+
+inline uint64_t archivePathHash(const string &path)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : path)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+class ResourceArchive
+{
+public:
+    ResourceArchive() : mapping(nullptr), mappingSize(0), entries(nullptr), entryCount(0), names(nullptr) {}
+    ~ResourceArchive() { close(); }
+
+    ResourceArchive(const ResourceArchive &) = delete;
+    ResourceArchive &operator=(const ResourceArchive &) = delete;
+
+    bool open(const string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ArchiveHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        mappingSize = (size_t)st.st_size;
+        mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            mapping = nullptr;
+            mappingSize = 0;
+            return false;
+        }
+
+        const unsigned char *base = (const unsigned char *)mapping;
+        ArchiveHeader header;
+        memcpy(&header, base, sizeof(header));
+        if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION ||
+            header.indexOffset > mappingSize || header.indexOffset % 8 != 0 ||
+            (mappingSize - header.indexOffset) / sizeof(ArchiveEntry) < header.entryCount ||
+            header.namesOffset > mappingSize)
+        {
+            close();
+            return false;
+        }
+        entries = (const ArchiveEntry *)(base + header.indexOffset);
+        entryCount = header.entryCount;
+        names = (const char *)(base + header.namesOffset);
+        for (size_t i = 0; i < entryCount; i++)
+            if (entries[i].offset + entries[i].size > mappingSize ||
+                header.namesOffset + entries[i].nameOffset + entries[i].nameLength > mappingSize)
+            {
+                close();
+                return false;
+            }
+        return true;
+    }
+
+    void close()
+    {
+        if (mapping)
+            munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+        entries = nullptr;
+        entryCount = 0;
+        names = nullptr;
+    }
+
+    bool isOpen() const
+    {
+        return mapping != nullptr;
+    }
+
+    // looks up a normalized path; data points into the mapping and stays valid while the archive is open
+    bool find(const string &path, const unsigned char *&data, size_t &size) const
+    {
+        uint64_t hash = archivePathHash(path);
+        const ArchiveEntry *end = entries + entryCount;
+        const ArchiveEntry *entry = std::lower_bound(entries, end, hash,
+                                                     [](const ArchiveEntry &e, uint64_t h) { return e.pathHash < h; });
+        for (; entry != end && entry->pathHash == hash; entry++)
+            if (path.compare(0, string::npos, names + entry->nameOffset, entry->nameLength) == 0)
+            {
+                data = (const unsigned char *)mapping + entry->offset;
+                size = (size_t)entry->size;
+                return true;
+            }
+        return false;
+    }
+
+    size_t size() const
+    {
+        return entryCount;
+    }
+
+    // packs files[i] (read from disk) under the archive name names[i]. Written under a temporary name and
+    // renamed into place, like the mesh cache.
+    static bool write(const string &archivePath, const vector<string> &names, const vector<string> &files)
+    {
+        string tmpPath = archivePath + ".tmp";
+        ofstream out(tmpPath, ios::binary | ios::trunc);
+        if (!out)
+            return false;
+
+        ArchiveHeader header = {ARCHIVE_MAGIC, ARCHIVE_VERSION, (uint32_t)names.size(), 0, 0, 0};
+        out.write((const char *)&header, sizeof(header));
+
+        vector<ArchiveEntry> index;
+        string nameTable;
+        vector<char> contents;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            ifstream in(files[i], ios::binary | ios::ate);
+            if (!in)
+            {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+            contents.resize((size_t)in.tellg());
+            in.seekg(0);
+            in.read(contents.data(), contents.size());
+
+            pad(out, 16);
+            ArchiveEntry entry;
+            entry.pathHash = archivePathHash(names[i]);
+            entry.offset = (uint64_t)out.tellp();
+            entry.size = contents.size();
+            entry.nameOffset = (uint32_t)nameTable.size();
+            entry.nameLength = (uint32_t)names[i].size();
+            index.push_back(entry);
+            nameTable += names[i];
+            out.write(contents.data(), contents.size());
+        }
+        std::stable_sort(index.begin(), index.end(), [](const ArchiveEntry &a, const ArchiveEntry &b) { return a.pathHash < b.pathHash; });
+
+        pad(out, 8);
+        header.indexOffset = (uint64_t)out.tellp();
+        out.write((const char *)index.data(), index.size() * sizeof(ArchiveEntry));
+        header.namesOffset = (uint64_t)out.tellp();
+        out.write(nameTable.data(), nameTable.size());
+        out.seekp(0);
+        out.write((const char *)&header, sizeof(header));
+        out.close();
+        if (!out || std::rename(tmpPath.c_str(), archivePath.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void *mapping;
+    size_t mappingSize;
+    const ArchiveEntry *entries;
+    size_t entryCount;
+    const char *names;
+
+    static void pad(ofstream &out, size_t alignment)
+    {
+        static const char zeros[16] = {0};
+        size_t position = (size_t)out.tellp();
+        out.write(zeros, (alignment - position % alignment) % alignment);
+    }
+};
+#endif
@@ -4,174 +4,442 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <utility>
 #include <iostream>
+#include <vector>
 #include <common.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/startup_profiler.h>
+
+// typed handle of one uniform of a Shader, resolved once by name (Shader::uniform). T is the C++ side of the
+// GLSL type: bool, int (also samplers), float, glm::vec2/3/4 or glm::mat2/3/4. A handle stays valid across hot
+// reloads, it refers to the name and not to a location of one program.
+template <typename T>
+struct UniformHandle {
+    int slot = -1;
+};
+
 class Shader
 {
 public:
     unsigned int ID;
+    // one uniform by name: every active uniform (and every element of arrays) found at link time, plus names
+    // asked for with uniform() that the program doesn't have (location -1, setting them does nothing)
+    struct UniformSlot {
+        std::string name;
+        GLint location;
+        GLenum type; // GL_NONE for names the program doesn't have
+    };
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : ""), serial(nextSerial())
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        bool linked;
+        ID = build(linked);
+        reflect();
+    }
+    // recompiles the program from its source files (hot reload). The new program replaces ID only if it
+    // compiled and linked, and takes over the uniform values of the old one, so state set once at startup
+    // (sampler units, constants) survives. Call between frames on the GL thread.
+    // ------------------------------------------------------------------------
+    bool reload()
+    {
+        bool linked;
+        unsigned int program = build(linked);
+        if (!linked)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            glDeleteProgram(program);
+            return false;
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        copyUniforms(ID, program);
+        glDeleteProgram(ID);
+        ID = program;
+        reflect();
+        return true;
     }
+    const std::string &getVertexPath() const { return vertexPath; }
+    const std::string &getFragmentPath() const { return fragmentPath; }
+    const std::string &getGeometryPath() const { return geometryPath; }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::get().useProgram(ID); 
     }
-    // utility uniform functions
+    // typed uniform handles
+    // ------------------------------------------------------------------------
+    // resolves name once; a name the program doesn't have (or one of another type) counts as a missed lookup
+    template <typename T>
+    UniformHandle<T> uniform(const std::string &name)
+    {
+        UniformHandle<T> handle;
+        handle.slot = find(name);
+        if (handle.slot < 0)
+        {
+            missedLookups++;
+            handle.slot = addSlot(name, -1, GL_NONE);
+            rebuildTable();
+        }
+        else if (slots[handle.slot].type != GL_NONE && !accepts<T>(slots[handle.slot].type))
+        {
+            missedLookups++;
+            std::cout << "WARNING::SHADER:: uniform " << name << " has another type in " << vertexPath << " + " << fragmentPath << std::endl;
+        }
+        return handle;
+    }
+    // sets the uniform of the program in use: one array read and the glUniform call
+    template <typename T>
+    void set(UniformHandle<T> handle, const T &value) const
+    {
+        if (handle.slot >= 0)
+            apply(slots[handle.slot].location, value);
+    }
+    // location of an active uniform by name, from the table built at link time; -1 (and a missed lookup) if
+    // the program doesn't have it
+    GLint location(const std::string &name) const
+    {
+        int slot = find(name);
+        if (slot < 0 || slots[slot].location < 0)
+        {
+            missedLookups++;
+            return -1;
+        }
+        return slots[slot].location;
+    }
+    // lookups by name or handle that didn't find an active uniform of the requested type, a debugging aid:
+    // typos and uniforms the GLSL compiler optimized away end up here
+    size_t getMissedLookups() const { return missedLookups; }
+    // unique per constructed Shader and kept across hot reloads, unlike ID and the object's address, which a
+    // later program or Shader can reuse; keys caches of handles (Mesh material tables)
+    uint64_t getSerial() const { return serial; }
+    const std::vector<UniformSlot> &getUniforms() const { return slots; }
+    // points the uniform block name at a binding point (UniformBuffer); kept across hot reloads. False if the
+    // program has no such block.
+    bool bindUniformBlock(const std::string &name, GLuint binding)
+    {
+        bool known = false;
+        for (auto &block : blockBindings)
+            if (block.first == name)
+            {
+                block.second = binding;
+                known = true;
+            }
+        if (!known)
+            blockBindings.push_back(std::make_pair(name, binding));
+        return applyBlockBinding(name, binding);
+    }
+    // utility uniform functions, by name through the same table
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(location(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(location(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(location(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(location(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(location(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    std::vector<UniformSlot> slots;
+    std::vector<int> table; // open addressing over slots by name hash, -1 = empty; size is a power of two
+    mutable size_t missedLookups = 0;
+    std::vector<std::pair<std::string, GLuint>> blockBindings;
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath; // empty without a geometry stage
+    uint64_t serial;
+
+    static uint64_t nextSerial()
+    {
+        static std::atomic<uint64_t> counter(0);
+        return ++counter;
+    }
+
+    unsigned int build(bool &linked)
+    {
+        ScopedTimer timer("shader", Vfs::get().relativeName(vertexPath) + " + " + Vfs::get().relativeName(fragmentPath));
+        bool hasGeometry = !geometryPath.empty();
+        // 1. retrieve the vertex/fragment source code from filePath
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::string geometryCode;
+        // read through the Vfs, which serves them from the resource archive when one is mounted
+        FileContents vShaderFile, fShaderFile, gShaderFile;
+        if (!Vfs::get().read(vertexPath, vShaderFile) || !Vfs::get().read(fragmentPath, fShaderFile) ||
+            (hasGeometry && !Vfs::get().read(geometryPath, gShaderFile)))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        }
+        vertexCode = vShaderFile.str();
+        fragmentCode = fShaderFile.str();
+        geometryCode = gShaderFile.str();
+        // 2. a program linked earlier from the same sources on the same driver is loaded as a binary
+        ProgramBinaryCache &binaries = ProgramBinaryCache::get();
+        uint64_t key = binaries.key(vertexCode, fragmentCode, geometryCode);
+        unsigned int program = glCreateProgram();
+        if (binaries.load(key, program))
+        {
+            linked = true;
+            return program;
+        }
+        glDeleteProgram(program);
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // 3. compile shaders
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        linked = checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        linked &= checkCompileErrors(fragment, "FRAGMENT");
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(hasGeometry)
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            linked &= checkCompileErrors(geometry, "GEOMETRY");
+        }
+        // shader Program
+        program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        if(hasGeometry)
+            glAttachShader(program, geometry);
+        binaries.prepare(program);
+        glLinkProgram(program);
+        linked &= checkCompileErrors(program, "PROGRAM");
+        if (linked)
+            binaries.store(key, program);
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(hasGeometry)
+            glDeleteShader(geometry);
+        return program;
+    }
+    // enumerates the active uniforms of ID into the slots. Slots of earlier programs (hot reload) keep their index,
+    // so handles stay valid, and get the new location or -1.
+    // ------------------------------------------------------------------------
+    void reflect()
+    {
+        for (UniformSlot &slot : slots)
+        {
+            slot.location = -1;
+            slot.type = GL_NONE;
+        }
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name((size_t)std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+            std::string base(name.data());
+            GLint first = glGetUniformLocation(ID, base.c_str());
+            if (first < 0)
+                continue; // member of a uniform block
+            bool array = base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0;
+            if (array)
+                base.erase(base.size() - 3);
+            // arrays: "a" and "a[0]" both name the first element
+            setSlot(base, first, type);
+            for (GLint element = 0; array && element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                setSlot(elementName, element == 0 ? first : glGetUniformLocation(ID, elementName.c_str()), type);
+            }
+        }
+        rebuildTable();
+        for (const auto &block : blockBindings)
+            applyBlockBinding(block.first, block.second);
+    }
+    bool applyBlockBinding(const std::string &name, GLuint binding)
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index == GL_INVALID_INDEX)
+        {
+            std::cout << "WARNING::SHADER:: no uniform block " << name << " in " << vertexPath << " + " << fragmentPath << std::endl;
+            return false;
+        }
+        glUniformBlockBinding(ID, index, binding);
+        return true;
+    }
+    void setSlot(const std::string &name, GLint location, GLenum type)
+    {
+        int slot = -1;
+        for (size_t i = 0; i < slots.size() && slot < 0; i++)
+            if (slots[i].name == name)
+                slot = (int)i;
+        if (slot < 0)
+            slot = addSlot(name, location, type);
+        slots[slot].location = location;
+        slots[slot].type = type;
+    }
+    int addSlot(const std::string &name, GLint location, GLenum type)
+    {
+        slots.push_back(UniformSlot{name, location, type});
+        return (int)slots.size() - 1;
+    }
+    static uint32_t hashName(const char *name, size_t length)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+        return hash;
+    }
+    void rebuildTable()
+    {
+        size_t size = 16;
+        while (size < slots.size() * 2)
+            size *= 2;
+        table.assign(size, -1);
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            size_t bucket = hashName(slots[i].name.data(), slots[i].name.size()) & (size - 1);
+            while (table[bucket] >= 0)
+                bucket = (bucket + 1) & (size - 1);
+            table[bucket] = (int)i;
+        }
+    }
+    int find(const std::string &name) const
+    {
+        if (table.empty())
+            return -1;
+        size_t mask = table.size() - 1;
+        for (size_t bucket = hashName(name.data(), name.size()) & mask; table[bucket] >= 0; bucket = (bucket + 1) & mask)
+            if (slots[table[bucket]].name == name)
+                return table[bucket];
+        return -1;
+    }
+    // whether a uniform of GLSL type can be set from T
+    template <typename T> static bool accepts(GLenum type);
+    static void apply(GLint location, bool value) { glUniform1i(location, (int)value); }
+    static void apply(GLint location, int value) { glUniform1i(location, value); }
+    static void apply(GLint location, float value) { glUniform1f(location, value); }
+    static void apply(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+    static void apply(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+    static void apply(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+    static void apply(GLint location, const glm::mat2 &value) { glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]); }
+    static void apply(GLint location, const glm::mat3 &value) { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+    static void apply(GLint location, const glm::mat4 &value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+    // copies the current value of every active uniform of from that also exists in to
+    // ------------------------------------------------------------------------
+    static void copyUniforms(unsigned int from, unsigned int to)
+    {
+        GLint previous;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(to);
+        GLint count;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(from, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+            std::string base(name);
+            if (base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+                base.erase(base.size() - 3);
+            for (GLint element = 0; element < size; element++)
+            {
+                std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : std::string(name);
+                GLint source = glGetUniformLocation(from, elementName.c_str());
+                GLint target = glGetUniformLocation(to, elementName.c_str());
+                if (source < 0 || target < 0)
+                    continue;
+                GLfloat f[16];
+                GLint n[4];
+                switch (type)
+                {
+                case GL_FLOAT:      glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+                case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+                case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+                case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+                case GL_FLOAT_MAT2: glGetUniformfv(from, source, f); glUniformMatrix2fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3: glGetUniformfv(from, source, f); glUniformMatrix3fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+                case GL_INT_VEC2:   glGetUniformiv(from, source, n); glUniform2iv(target, 1, n); break;
+                case GL_INT_VEC3:   glGetUniformiv(from, source, n); glUniform3iv(target, 1, n); break;
+                case GL_INT_VEC4:   glGetUniformiv(from, source, n); glUniform4iv(target, 1, n); break;
+                default: // int, bool and sampler uniforms
+                    glGetUniformiv(from, source, n);
+                    glUniform1i(target, n[0]);
+                    break;
+                }
+            }
+        }
+        glUseProgram((GLuint)previous);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +461,23 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success == GL_TRUE;
     }
 };
+
+template <> inline bool Shader::accepts<bool>(GLenum type) { return type == GL_BOOL || type == GL_INT; }
+template <> inline bool Shader::accepts<float>(GLenum type) { return type == GL_FLOAT; }
+template <> inline bool Shader::accepts<glm::vec2>(GLenum type) { return type == GL_FLOAT_VEC2; }
+template <> inline bool Shader::accepts<glm::vec3>(GLenum type) { return type == GL_FLOAT_VEC3; }
+template <> inline bool Shader::accepts<glm::vec4>(GLenum type) { return type == GL_FLOAT_VEC4; }
+template <> inline bool Shader::accepts<glm::mat2>(GLenum type) { return type == GL_FLOAT_MAT2; }
+template <> inline bool Shader::accepts<glm::mat3>(GLenum type) { return type == GL_FLOAT_MAT3; }
+template <> inline bool Shader::accepts<glm::mat4>(GLenum type) { return type == GL_FLOAT_MAT4; }
+// int covers bool and every sampler type
+template <> inline bool Shader::accepts<int>(GLenum type)
+{
+    return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE ||
+           type == GL_SAMPLER_2D_SHADOW || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_2D_MULTISAMPLE ||
+           type == GL_INT_SAMPLER_2D || type == GL_UNSIGNED_INT_SAMPLER_2D || type == GL_SAMPLER_BUFFER;
+}
 #endif
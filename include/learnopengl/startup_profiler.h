@@ -0,0 +1,171 @@
+#ifndef STARTUP_PROFILER_H
+#define STARTUP_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Collects the time spent in each startup phase (window, GLAD, shaders, model import, texture decode, upload)
+// and in every single asset load. Timers are recorded from any thread; phases that run on the thread pool
+// overlap, so their sum can exceed the wall time. report() prints the entries sorted by duration and writeJson()
+// stores them for CI, which compares cold and warm starts against earlier runs.
+class StartupProfiler
+{
+public:
+    struct Entry {
+        string category; // phase, shader, model import, texture decode, ...
+        string name;     // asset path or phase name
+        double startMs;  // since the profiler was created
+        double durationMs;
+    };
+
+    static StartupProfiler &get()
+    {
+        static StartupProfiler profiler;
+        return profiler;
+    }
+
+    double nowMs() const
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - origin).count();
+    }
+
+    void record(const string &category, const string &name, double startMs, double durationMs)
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (!finished)
+            entries.push_back(Entry{category, name, startMs, durationMs});
+    }
+
+    // records the time from startMs (nowMs() earlier) until now, for phases that don't fit a scope
+    void recordSince(const string &category, const string &name, double startMs)
+    {
+        record(category, name, startMs, nowMs() - startMs);
+    }
+
+    // extra facts about the run that go into the JSON file (e.g. how many models came from the mesh cache)
+    void setValue(const string &key, double value)
+    {
+        lock_guard<mutex> lock(mutex_);
+        values[key] = value;
+    }
+
+    // ends the startup; later timers are ignored
+    void finish()
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (!finished)
+            totalMs = nowMs();
+        finished = true;
+    }
+
+    bool isFinished()
+    {
+        lock_guard<mutex> lock(mutex_);
+        return finished;
+    }
+
+    void report(ostream &out)
+    {
+        lock_guard<mutex> lock(mutex_);
+        vector<Entry> sorted = entries;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) { return a.durationMs > b.durationMs; });
+        map<string, double> perCategory;
+        for (const Entry &entry : entries)
+            perCategory[entry.category] += entry.durationMs;
+
+        char line[512];
+        out << "Startup: " << totalMs << " ms" << endl;
+        snprintf(line, sizeof(line), "%-16s %10s  %s", "category", "ms", "name");
+        out << line << endl;
+        for (const Entry &entry : sorted)
+        {
+            snprintf(line, sizeof(line), "%-16s %10.2f  %s", entry.category.c_str(), entry.durationMs, entry.name.c_str());
+            out << line << endl;
+        }
+        out << "per category (worker threads overlap):" << endl;
+        for (const auto &category : perCategory)
+        {
+            snprintf(line, sizeof(line), "%-16s %10.2f", category.first.c_str(), category.second);
+            out << line << endl;
+        }
+    }
+
+    bool writeJson(const string &path)
+    {
+        lock_guard<mutex> lock(mutex_);
+        ofstream out(path, ios::trunc);
+        if (!out)
+            return false;
+        out << "{\n  \"total_ms\": " << totalMs << ",\n  \"values\": {";
+        bool first = true;
+        for (const auto &value : values)
+        {
+            out << (first ? "\n" : ",\n") << "    \"" << escape(value.first) << "\": " << value.second;
+            first = false;
+        }
+        out << (values.empty() ? "" : "\n  ") << "},\n  \"entries\": [";
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const Entry &entry = entries[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"category\": \"" << escape(entry.category) << "\", \"name\": \""
+                << escape(entry.name) << "\", \"start_ms\": " << entry.startMs << ", \"ms\": " << entry.durationMs << "}";
+        }
+        out << (entries.empty() ? "" : "\n  ") << "]\n}\n";
+        return (bool)out;
+    }
+
+private:
+    chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    mutex mutex_;
+    vector<Entry> entries;
+    map<string, double> values;
+    double totalMs = 0.0;
+    bool finished = false;
+
+    StartupProfiler() {}
+
+    static string escape(const string &s)
+    {
+        string escaped;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if ((unsigned char)c < 0x20)
+                continue;
+            escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// times the enclosing scope
+class ScopedTimer
+{
+public:
+    ScopedTimer(const string &category, const string &name)
+        : category(category), name(name), startMs(StartupProfiler::get().nowMs()) {}
+
+    ~ScopedTimer()
+    {
+        StartupProfiler &profiler = StartupProfiler::get();
+        profiler.record(category, name, startMs, profiler.nowMs() - startMs);
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    string category;
+    string name;
+    double startMs;
+};
+#endif
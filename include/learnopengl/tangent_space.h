@@ -0,0 +1,213 @@
+#ifndef TANGENT_SPACE_H
+#define TANGENT_SPACE_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/thread_pool.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Smooth normals and tangent space for triangle lists, replacing Assimp's aiProcess_GenSmoothNormals and
+// aiProcess_CalcTangentSpace (ModelOptions::nativeTangentSpace). Per triangle work and the per vertex sums run
+// in parallel over ranges on the shared thread pool; sums are accumulated four floats at a time.
+//
+// - normals: the normalized face normals of all triangles touching a position are averaged, vertices at the
+//   same position get the same normal (what GenSmoothNormals does without an angle limit)
+// - tangents follow MikkTSpace: per corner, the triangle's texture space tangent is projected into the plane of
+//   the vertex normal, normalized and weighted by the corner angle; corners of vertices equal in position, normal
+//   and texture coordinates are summed. The bitangent is cross(normal, tangent) times the handedness sign, so a
+//   shader rebuilding it from normal, tangent and sign gets the same frame.
+
+const size_t TANGENT_SPACE_GRAIN = 16 * 1024; // triangles or vertices per parallel chunk
+
+struct alignas(16) Float4 {
+    float v[4];
+};
+
+inline void addScaled(Float4 &sum, const Float4 &value, float weight)
+{
+#if defined(__SSE2__)
+    _mm_store_ps(sum.v, _mm_add_ps(_mm_load_ps(sum.v), _mm_mul_ps(_mm_load_ps(value.v), _mm_set1_ps(weight))));
+#else
+    for (int i = 0; i < 4; i++)
+        sum.v[i] += value.v[i] * weight;
+#endif
+}
+
+inline Float4 toFloat4(const glm::vec3 &v, float w = 0.0f)
+{
+    Float4 f = {{v.x, v.y, v.z, w}};
+    return f;
+}
+
+inline glm::vec3 xyz(const Float4 &f)
+{
+    return glm::vec3(f.v[0], f.v[1], f.v[2]);
+}
+
+// groups vertices whose key (a run of floats inside Vertex) is bitwise equal; returns the group of each vertex
+// and the number of groups
+inline size_t groupVertices(const vector<Vertex> &vertices, size_t keyFloats, vector<uint32_t> &group)
+{
+    struct KeyHash {
+        size_t floats;
+        size_t operator()(const Vertex *v) const
+        {
+            uint64_t hash = 14695981039346656037ull;
+            const uint32_t *words = (const uint32_t *)v;
+            for (size_t i = 0; i < floats; i++)
+                hash = (hash ^ words[i]) * 1099511628211ull;
+            return (size_t)hash;
+        }
+    };
+    struct KeyEqual {
+        size_t floats;
+        bool operator()(const Vertex *a, const Vertex *b) const
+        {
+            return memcmp(a, b, floats * sizeof(float)) == 0;
+        }
+    };
+    unordered_map<const Vertex *, uint32_t, KeyHash, KeyEqual> groups(vertices.size(), KeyHash{keyFloats}, KeyEqual{keyFloats});
+    group.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        group[i] = groups.emplace(&vertices[i], (uint32_t)groups.size()).first->second;
+    return groups.size();
+}
+
+// corner lists per group (compressed rows): corners of group g are corners[offsets[g] .. offsets[g + 1])
+inline void cornersByGroup(const vector<unsigned int> &indices, const vector<uint32_t> &group, size_t groupCount,
+                           vector<uint32_t> &offsets, vector<uint32_t> &corners)
+{
+    offsets.assign(groupCount + 1, 0);
+    for (unsigned int index : indices)
+        offsets[group[index] + 1]++;
+    for (size_t g = 0; g < groupCount; g++)
+        offsets[g + 1] += offsets[g];
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    corners.resize(indices.size());
+    for (size_t c = 0; c < indices.size(); c++)
+        corners[fill[group[indices[c]]]++] = (uint32_t)c;
+}
+
+// any unit vector perpendicular to n
+inline glm::vec3 perpendicular(const glm::vec3 &n)
+{
+    glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::normalize(axis - n * glm::dot(n, axis));
+}
+
+// generateNormals: also (re)compute Normal, for meshes imported without normals
+inline void generateTangentSpace(vector<Vertex> &vertices, const vector<unsigned int> &indices, bool generateNormals)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+    ThreadPool &pool = ThreadPool::shared();
+
+    // per triangle: normal, texture space tangent (w: handedness) and the angle at each corner
+    vector<Float4> faceNormals(triangleCount), faceTangents(triangleCount);
+    vector<float> cornerAngles(triangleCount * 3);
+    pool.parallelFor(triangleCount, TANGENT_SPACE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+        {
+            const Vertex &a = vertices[indices[t * 3]], &b = vertices[indices[t * 3 + 1]], &c = vertices[indices[t * 3 + 2]];
+            glm::vec3 e1 = b.Position - a.Position, e2 = c.Position - a.Position;
+            glm::vec3 normal = glm::cross(e1, e2);
+            float length = glm::length(normal);
+            faceNormals[t] = toFloat4(length > 0.0f ? normal / length : glm::vec3(0.0f));
+
+            glm::vec2 d1 = b.TexCoords - a.TexCoords, d2 = c.TexCoords - a.TexCoords;
+            float det = d1.x * d2.y - d2.x * d1.y;
+            glm::vec3 tangent(0.0f), bitangent(0.0f);
+            if (std::fabs(det) > 1e-20f)
+            {
+                tangent = (e1 * d2.y - e2 * d1.y) / det;
+                bitangent = (e2 * d1.x - e1 * d2.x) / det;
+            }
+            float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+            faceTangents[t] = toFloat4(tangent, handedness);
+
+            const glm::vec3 *p[3] = {&a.Position, &b.Position, &c.Position};
+            for (int k = 0; k < 3; k++)
+            {
+                glm::vec3 u = *p[(k + 1) % 3] - *p[k], v = *p[(k + 2) % 3] - *p[k];
+                float lu = glm::length(u), lv = glm::length(v);
+                float cosine = lu > 0.0f && lv > 0.0f ? glm::dot(u, v) / (lu * lv) : 1.0f;
+                cornerAngles[t * 3 + k] = std::acos(std::max(-1.0f, std::min(1.0f, cosine)));
+            }
+        }
+    });
+
+    vector<uint32_t> group, offsets, corners;
+    if (generateNormals)
+    {
+        // Position is the first member of Vertex: group by position only
+        size_t groups = groupVertices(vertices, 3, group);
+        cornersByGroup(indices, group, groups, offsets, corners);
+        vector<glm::vec3> normals(groups);
+        pool.parallelFor(groups, TANGENT_SPACE_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t g = begin; g < end; g++)
+            {
+                Float4 sum = {{0.0f, 0.0f, 0.0f, 0.0f}};
+                for (uint32_t i = offsets[g]; i < offsets[g + 1]; i++)
+                    addScaled(sum, faceNormals[corners[i] / 3], 1.0f);
+                glm::vec3 n = xyz(sum);
+                float length = glm::length(n);
+                normals[g] = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+        });
+        for (size_t i = 0; i < vertices.size(); i++)
+            vertices[i].Normal = normals[group[i]];
+    }
+
+    // Position, Normal and TexCoords lead Vertex: group by all three, like MikkTSpace does
+    size_t groups = groupVertices(vertices, 8, group);
+    cornersByGroup(indices, group, groups, offsets, corners);
+    vector<uint32_t> firstVertex(groups, UINT32_MAX);
+    for (size_t i = 0; i < vertices.size(); i++)
+        if (firstVertex[group[i]] == UINT32_MAX)
+            firstVertex[group[i]] = (uint32_t)i;
+    vector<glm::vec3> tangents(groups), bitangents(groups);
+    pool.parallelFor(groups, TANGENT_SPACE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t g = begin; g < end; g++)
+        {
+            glm::vec3 n = vertices[firstVertex[g]].Normal;
+            Float4 sum = {{0.0f, 0.0f, 0.0f, 0.0f}};
+            for (uint32_t i = offsets[g]; i < offsets[g + 1]; i++)
+            {
+                uint32_t corner = corners[i];
+                const Float4 &face = faceTangents[corner / 3];
+                glm::vec3 t = xyz(face);
+                t -= n * glm::dot(n, t);
+                float length = glm::length(t);
+                if (length <= 0.0f)
+                    continue;
+                // w collects the angle weighted handedness
+                addScaled(sum, toFloat4(t / length, face.v[3]), cornerAngles[corner]);
+            }
+            glm::vec3 t = xyz(sum);
+            float length = glm::length(t);
+            t = length > 0.0f ? t / length : perpendicular(n);
+            float sign = sum.v[3] < 0.0f ? -1.0f : 1.0f;
+            tangents[g] = t;
+            bitangents[g] = glm::cross(n, t) * sign;
+        }
+    });
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        vertices[i].Tangent = tangents[group[i]];
+        vertices[i].Bitangent = bitangents[group[i]];
+    }
+}
+#endif
@@ -0,0 +1,547 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/ktx.h>
+#include <learnopengl/startup_profiler.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Decodes images on the shared thread pool while the GL thread only uploads them.
+// load2D/loadCubemap hand out the texture name right away and schedule the decode; the image data
+// is uploaded by uploadReady()/finish(), which must be called from the thread that owns the GL context.
+//
+// In streaming mode every texture starts out as a 1x1 placeholder and update(), called once per frame,
+// moves at most a fixed number of bytes per frame: the rows (of 4x4 blocks for compressed images) that fit
+// are copied into a pixel buffer object and uploaded from it with glTexSubImage2D. A decoded image keeps
+// showing the grey placeholder from its smallest mip level until all rows are in, then gets its mipmaps
+// generated; a baked image streams its mip chain smallest level first and shows each level once complete.
+//
+// 2D textures with a baked, block compressed counterpart (see ktx.h and tools/bake_textures.cpp) are read
+// from the .ktx file instead and uploaded with their precomputed mip chain.
+//
+// Files are read through the Vfs, so images packed into the mounted archive are decoded straight from the mapping.
+class TextureLoader
+{
+public:
+    static TextureLoader &get()
+    {
+        static TextureLoader loader;
+        return loader;
+    }
+
+    // has to be set before any texture is loaded
+    void setStreaming(bool enabled, size_t bytesPerFrame = 8 * 1024 * 1024)
+    {
+        streaming = enabled;
+        streamBudget = std::max<size_t>(bytesPerFrame, 1);
+    }
+
+    bool isStreaming() const
+    {
+        return streaming;
+    }
+
+    unsigned int load2D(const string &path)
+    {
+        unsigned int textureID = createTexture2D();
+        schedule(textureID, GL_TEXTURE_2D, imageSource(path), FileContents(), nullptr, path);
+        return textureID;
+    }
+
+    // called on the GL thread once the image is specified (loaded) or its decode failed
+    typedef function<void(unsigned int texture, bool loaded)> UploadCallback;
+
+    // same as load2D, for a file that has already been read into memory (an encoded image or a KTX file).
+    // sourcePath is the image a baked file was made from, read and decoded instead if the KTX file is invalid.
+    unsigned int load2DFromMemory(const string &name, FileContents file, UploadCallback uploaded = nullptr, const string &sourcePath = string())
+    {
+        unsigned int textureID = createTexture2D();
+        schedule(textureID, GL_TEXTURE_2D, name, std::move(file), std::move(uploaded), sourcePath);
+        return textureID;
+    }
+
+    // faces in the order +X, -X, +Y, -Y, +Z, -Z
+    unsigned int loadCubemap(const vector<string> &faces)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+        for (unsigned int i = 0; i < faces.size(); i++)
+        {
+            if (streaming)
+                setPlaceholder(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+            schedule(textureID, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i], FileContents());
+        }
+        return textureID;
+    }
+
+    // streaming mode: call once per frame on the GL thread
+    void update()
+    {
+        size_t budget = streamBudget;
+        while (budget > 0)
+        {
+            if (!streamActive)
+            {
+                if (!popDecoded(active))
+                    return;
+                if (!hasData(active))
+                {
+                    upload(active); // decode failed, only reports the error
+                    continue;
+                }
+                beginStream();
+            }
+            budget -= std::min(budget, streamSlice(budget));
+        }
+    }
+
+    // true once every scheduled image is uploaded
+    bool idle()
+    {
+        lock_guard<mutex> lock(mutex_);
+        return pending == 0;
+    }
+
+    // uploads every image whose decode has finished, without waiting for the rest
+    void uploadReady()
+    {
+        Job job;
+        while (popDecoded(job))
+            upload(job);
+    }
+
+    // blocks until every scheduled image is decoded and uploaded, uploading them in completion order
+    void finish()
+    {
+        while (streamActive)
+            streamSlice(imageSize(active));
+        for (;;)
+        {
+            Job job;
+            {
+                unique_lock<mutex> lock(mutex_);
+                decodeDone.wait(lock, [this] { return !decoded.empty() || pending == 0; });
+                if (decoded.empty())
+                    return;
+                job = std::move(decoded.front());
+                decoded.pop_front();
+            }
+            upload(job);
+        }
+    }
+
+    // the file a 2D image is read from: its baked counterpart if that is packed or current on disk. A packed
+    // one is stale once the source changed on disk (hot reload).
+    static string imageSource(const string &path)
+    {
+        string baked = bakedTexturePath(path);
+        if ((Vfs::get().inArchive(baked) && !Vfs::get().isLoose(path)) || bakedTextureIsCurrent(path))
+            return baked;
+        return path;
+    }
+
+private:
+    struct Job {
+        unsigned int texture;
+        GLenum target;
+        string path;
+        string sourcePath;              // decoded instead of a baked path that fails to parse (empty: none)
+        unsigned char *pixels;          // decoded image (stb_image)
+        int width, height, components;
+        FileContents file;              // encoded image or baked KTX file, levels point into it
+        KtxImage ktx;
+        bool compressed;
+        UploadCallback uploaded;
+    };
+
+    mutex mutex_;
+    condition_variable decodeDone;
+    deque<Job> decoded;
+    size_t pending = 0; // scheduled images that are not uploaded yet
+
+    bool streaming = false;
+    size_t streamBudget = 0;
+    Job active = Job();         // image currently being streamed
+    bool streamActive = false;
+    unsigned int pbo = 0;
+    size_t streamStep = 0;      // index of the level being streamed (see streamLevel)
+    unsigned int streamRow = 0; // next row of that level, in blocks for compressed images
+
+    // one mip level of the active image: where its data starts, the bytes per row and the row count
+    struct StreamLevel {
+        GLint level;
+        size_t offset;
+        size_t rowBytes;
+        unsigned int rows;
+        GLsizei width, height;
+    };
+
+    TextureLoader() {}
+
+    unsigned int createTexture2D()
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (streaming)
+        {
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            setPlaceholder(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        return textureID;
+    }
+
+    static bool hasData(const Job &job)
+    {
+        return job.compressed || job.pixels;
+    }
+
+    static const unsigned char *imageData(const Job &job)
+    {
+        return job.compressed ? job.file.data : job.pixels;
+    }
+
+    static size_t imageSize(const Job &job)
+    {
+        return job.compressed ? job.file.size : (size_t)job.width * job.height * job.components;
+    }
+
+    // runs on a worker thread; job.file is either empty (read job.path) or already holds the file
+    static void decode(Job &job)
+    {
+        ScopedTimer timer("texture decode", Vfs::get().relativeName(job.path));
+        job.pixels = nullptr;
+        job.compressed = false;
+        if (job.file.empty() && !Vfs::get().read(job.path, job.file))
+            return;
+        if (job.file.size >= sizeof(KTX_IDENTIFIER) && memcmp(job.file.data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0)
+        {
+            job.compressed = parseKtx(job.file.data, job.file.size, job.ktx) && !job.ktx.levels.empty();
+            if (job.compressed)
+                return;
+            // not a file the bake step wrote (corrupt or foreign): decode the image it was baked from
+            job.file = FileContents();
+            if (job.sourcePath.empty() || job.sourcePath == job.path)
+                return;
+            std::cout << "Invalid baked texture " << job.path << ", loading " << job.sourcePath << std::endl;
+            if (!Vfs::get().read(job.sourcePath, job.file))
+                return;
+        }
+        job.pixels = stbi_load_from_memory(job.file.data, (int)job.file.size, &job.width, &job.height, &job.components, 0);
+        job.file = FileContents();
+    }
+
+    static GLenum formatFor(int components)
+    {
+        if (components == 1)
+            return GL_RED;
+        else if (components == 4)
+            return GL_RGBA;
+        return GL_RGB;
+    }
+
+    static void setPlaceholder(GLenum target, GLint level = 0)
+    {
+        static const unsigned char grey[4] = {128, 128, 128, 255};
+        glTexImage2D(target, level, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    }
+
+    bool popDecoded(Job &job)
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (decoded.empty())
+            return false;
+        job = std::move(decoded.front());
+        decoded.pop_front();
+        return true;
+    }
+
+    // levels in streaming order: a decoded image has only level 0, a baked one goes from its smallest level up
+    size_t streamLevels() const
+    {
+        return active.compressed ? active.ktx.levels.size() : 1;
+    }
+
+    StreamLevel streamLevel(size_t step) const
+    {
+        StreamLevel level;
+        if (!active.compressed)
+        {
+            level.level = 0;
+            level.offset = 0;
+            level.width = active.width;
+            level.height = active.height;
+            level.rowBytes = (size_t)active.width * active.components;
+            level.rows = (unsigned int)active.height;
+            return level;
+        }
+        size_t index = active.ktx.levels.size() - 1 - step;
+        const KtxLevel &l = active.ktx.levels[index];
+        level.level = (GLint)index;
+        level.offset = l.offset;
+        level.width = l.width;
+        level.height = l.height;
+        level.rows = (l.height + 3) / 4;
+        level.rowBytes = l.size / level.rows;
+        return level;
+    }
+
+    // allocates the texture storage and the pixel buffer of the active image
+    void beginStream()
+    {
+        if (pbo == 0)
+            glGenBuffers(1, &pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        // orphans the previous storage, the driver may still be reading it for the last texture
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, imageSize(active), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        streamStep = 0;
+        streamRow = 0;
+        streamActive = true;
+
+        if (active.compressed)
+        {
+            glBindTexture(GL_TEXTURE_2D, active.texture);
+            for (size_t level = 0; level < active.ktx.levels.size(); level++)
+            {
+                const KtxLevel &l = active.ktx.levels[level];
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, active.ktx.internalFormat, l.width, l.height, 0, (GLsizei)l.size, nullptr);
+            }
+            // sampled from the finest complete level, the smallest ones come in within the first frame
+            GLint last = (GLint)active.ktx.levels.size() - 1;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        else if (active.target == GL_TEXTURE_2D)
+        {
+            GLenum format = formatFor(active.components);
+            glBindTexture(GL_TEXTURE_2D, active.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, active.width, active.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            // the placeholder moves to the 1x1 level, the only one sampled until level 0 is complete
+            GLint last = 0;
+            while ((std::max(active.width, active.height) >> (last + 1)) > 0)
+                last++;
+            if (last > 0)
+                setPlaceholder(GL_TEXTURE_2D, last);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, active.texture);
+            glTexImage2D(active.target, 0, GL_RGB, active.width, active.height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+
+    // copies the rows of the active level that fit in maxBytes (at least one) into the pixel buffer and
+    // uploads them; returns the number of bytes moved. Ends the stream after the last row.
+    size_t streamSlice(size_t maxBytes)
+    {
+        StreamLevel level = streamLevel(streamStep);
+        unsigned int rows = (unsigned int)std::min<size_t>(std::max<size_t>(maxBytes / level.rowBytes, 1), level.rows - streamRow);
+        size_t offset = level.offset + streamRow * level.rowBytes;
+        size_t bytes = rows * level.rowBytes;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!dst)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            uploadDirectly("could not map its buffer");
+            return bytes;
+        }
+        memcpy(dst, imageData(active) + offset, bytes);
+        bool mapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+
+        double start = StartupProfiler::get().nowMs();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // the buffer holds tightly packed rows
+        if (active.compressed)
+        {
+            GLsizei height = std::min<GLsizei>((GLsizei)rows * 4, level.height - (GLsizei)streamRow * 4);
+            glBindTexture(GL_TEXTURE_2D, active.texture);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level.level, 0, (GLint)streamRow * 4, level.width, height, active.ktx.internalFormat,
+                                      (GLsizei)bytes, (const void *)offset);
+        }
+        else
+        {
+            glBindTexture(active.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP, active.texture);
+            glTexSubImage2D(active.target, 0, 0, (GLint)streamRow, level.width, (GLsizei)rows, formatFor(active.components), GL_UNSIGNED_BYTE,
+                            (const void *)offset);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        StartupProfiler::get().recordSince("texture upload", Vfs::get().relativeName(active.path), start);
+
+        if (!mapped)
+        {
+            uploadDirectly("lost its buffer"); // e.g. a display mode switch
+            return bytes;
+        }
+
+        streamRow += rows;
+        if (streamRow == level.rows)
+        {
+            streamRow = 0;
+            streamStep++;
+            if (active.compressed)
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level.level);
+            if (streamStep == streamLevels())
+                endStream();
+        }
+        return bytes;
+    }
+
+    // every row of the active image is uploaded
+    void endStream()
+    {
+        if (active.compressed)
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        else if (active.target == GL_TEXTURE_2D)
+        {
+            glBindTexture(GL_TEXTURE_2D, active.texture);
+            resetLevels(active);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        if (active.uploaded)
+            active.uploaded(active.texture, true);
+        stbi_image_free(active.pixels);
+        active = Job();
+        streamActive = false;
+
+        lock_guard<mutex> lock(mutex_);
+        pending--;
+    }
+
+    // gives up streaming the active image and specifies it from memory in one go
+    void uploadDirectly(const char *reason)
+    {
+        std::cout << "Texture streaming " << reason << ", uploading directly: " << active.path << std::endl;
+        streamActive = false;
+        resetLevels(active);
+        upload(active);
+        active = Job();
+    }
+
+    // undoes the level range of a partly streamed 2D image
+    static void resetLevels(const Job &job)
+    {
+        if (job.target != GL_TEXTURE_2D)
+            return;
+        glBindTexture(GL_TEXTURE_2D, job.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    }
+
+    void schedule(unsigned int texture, GLenum target, const string &path, FileContents file, UploadCallback uploaded = nullptr,
+                  const string &sourcePath = string())
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            pending++;
+        }
+        // std::function needs a copyable callable, so the file contents travel through a shared_ptr
+        auto data = make_shared<FileContents>(std::move(file));
+        ThreadPool::shared().enqueue([this, texture, target, path, sourcePath, data, uploaded] {
+            Job job;
+            job.texture = texture;
+            job.target = target;
+            job.path = path;
+            job.sourcePath = sourcePath;
+            job.uploaded = uploaded;
+            job.file = std::move(*data);
+            decode(job);
+            {
+                lock_guard<mutex> lock(mutex_);
+                decoded.push_back(std::move(job));
+            }
+            decodeDone.notify_one();
+        });
+    }
+
+    // specifies the texture image from pixels, or from the bound pixel unpack buffer when pixels is null
+    void specify(const Job &job, const unsigned char *pixels)
+    {
+        GLenum format = formatFor(job.components);
+        if (job.compressed)
+        {
+            glBindTexture(GL_TEXTURE_2D, job.texture);
+            for (size_t level = 0; level < job.ktx.levels.size(); level++)
+            {
+                const KtxLevel &l = job.ktx.levels[level];
+                const void *data = pixels ? (const void *)(pixels + l.offset) : (const void *)l.offset;
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, job.ktx.internalFormat, l.width, l.height, 0, (GLsizei)l.size, data);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)job.ktx.levels.size() - 1);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        else if (job.target == GL_TEXTURE_2D)
+        {
+            glBindTexture(GL_TEXTURE_2D, job.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, job.width, job.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+            glGenerateMipmap(GL_TEXTURE_2D);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, job.texture);
+            glTexImage2D(job.target, 0, GL_RGB, job.width, job.height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        }
+    }
+
+    void upload(Job &job)
+    {
+        if (hasData(job))
+        {
+            ScopedTimer timer("texture upload", Vfs::get().relativeName(job.path));
+            specify(job, imageData(job));
+        }
+        else if (job.target == GL_TEXTURE_2D)
+            std::cout << "Texture failed to load at path: " << job.path << std::endl;
+        else
+            std::cout << "Cubemap texture failed to load at path: " << job.path << std::endl;
+        if (job.uploaded)
+            job.uploaded(job.texture, hasData(job));
+        stbi_image_free(job.pixels);
+
+        lock_guard<mutex> lock(mutex_);
+        pending--;
+    }
+};
+#endif
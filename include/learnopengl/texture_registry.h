@@ -0,0 +1,229 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/ktx.h>
+#include <learnopengl/texture_loader.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Process-wide registry of 2D textures keyed by a hash of the file contents, so the same image is decoded
+// and uploaded once no matter how many models (or which paths) refer to it. Textures are shared through
+// reference counted TextureHandles and the GL texture is deleted when the last handle goes away.
+class TextureRegistry;
+
+class TextureHandle
+{
+public:
+    TextureHandle() {}
+
+    unsigned int id() const
+    {
+        return entry ? entry->id : 0;
+    }
+
+    explicit operator bool() const
+    {
+        return (bool)entry;
+    }
+
+private:
+    friend class TextureRegistry;
+
+    struct Entry {
+        uint64_t hash;
+        unsigned int id;
+        ~Entry();
+    };
+
+    shared_ptr<Entry> entry;
+
+    explicit TextureHandle(shared_ptr<Entry> entry) : entry(std::move(entry)) {}
+};
+
+class TextureRegistry
+{
+public:
+    static TextureRegistry &get()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // returns the texture for the image at path (or its baked counterpart), loading it only if no live
+    // texture with the same contents exists. The image itself is decoded by the TextureLoader.
+    TextureHandle acquire(const string &path)
+    {
+        shared_ptr<TextureHandle::Entry> entry = acquireEntry(path);
+        if (entry)
+            acquiredFrom[Vfs::get().relativeName(path)] = AcquiredPath{path, entry};
+        return TextureHandle(entry);
+    }
+
+    // hot reload: reloads the live textures acquired from path, or whose baked file is path. The new image is
+    // decoded in the background and swapped in on the GL thread once uploaded; handles keep pointing to the
+    // same entry, so everything holding one picks the new texture up with its next id() call. Textures that
+    // were shared because two paths had identical contents change for both paths.
+    // Returns the number of textures being reloaded.
+    size_t reload(const string &path)
+    {
+        string name = Vfs::get().relativeName(path);
+        size_t reloading = 0;
+        for (auto &acquired : acquiredFrom)
+        {
+            if (acquired.first != name && Vfs::get().relativeName(bakedTexturePath(acquired.second.path)) != name)
+                continue;
+            shared_ptr<TextureHandle::Entry> live = acquired.second.entry.lock();
+            if (!live)
+                continue;
+            string source = TextureLoader::imageSource(acquired.second.path);
+            FileContents data;
+            if (!Vfs::get().read(source, data))
+                continue; // e.g. removed while being rewritten, the next change event retries
+            uint64_t hash = contentHash(data.data, data.size);
+            contentOfPath[source] = hash;
+            if (hash == live->hash)
+                continue;
+            weak_ptr<TextureHandle::Entry> target = live;
+            TextureLoader::get().load2DFromMemory(source, std::move(data), [this, target, hash](unsigned int texture, bool loaded) {
+                shared_ptr<TextureHandle::Entry> entry = target.lock();
+                if (!loaded || !entry || closed)
+                {
+                    glDeleteTextures(1, &texture);
+                    return;
+                }
+                replace(entry, texture, hash);
+            }, acquired.second.path);
+            reloading++;
+        }
+        return reloading;
+    }
+
+    // number of live textures
+    size_t size() const
+    {
+        return textures.size();
+    }
+
+    // deletes all GL textures; handles released afterwards (e.g. by objects destroyed after the
+    // context is gone) no longer call into OpenGL
+    void shutdown()
+    {
+        for (auto &texture : textures)
+            if (shared_ptr<TextureHandle::Entry> live = texture.second.lock())
+            {
+                glDeleteTextures(1, &live->id);
+                live->id = 0;
+            }
+        textures.clear();
+        contentOfPath.clear();
+        acquiredFrom.clear();
+        closed = true;
+    }
+
+    // 64-bit hash of the file contents, processed a word at a time
+    static uint64_t contentHash(const unsigned char *data, size_t size)
+    {
+        const uint64_t prime = 0x100000001b3ull;
+        uint64_t hash = 0xcbf29ce484222325ull ^ (size * prime);
+        size_t words = size / 8;
+        for (size_t i = 0; i < words; i++)
+        {
+            uint64_t word;
+            memcpy(&word, &data[i * 8], 8);
+            hash = (hash ^ word) * prime;
+            hash ^= hash >> 29;
+        }
+        for (size_t i = words * 8; i < size; i++)
+            hash = (hash ^ data[i]) * prime;
+        return hash;
+    }
+
+private:
+    friend struct TextureHandle::Entry;
+
+    unordered_map<uint64_t, weak_ptr<TextureHandle::Entry>> textures;
+    unordered_map<string, uint64_t> contentOfPath;
+    // requested paths by their Vfs name, for hot reload
+    struct AcquiredPath {
+        string path;
+        weak_ptr<TextureHandle::Entry> entry;
+    };
+    unordered_map<string, AcquiredPath> acquiredFrom;
+    bool closed = false;
+
+    TextureRegistry() {}
+
+    shared_ptr<TextureHandle::Entry> acquireEntry(const string &path)
+    {
+        string source = TextureLoader::imageSource(path);
+
+        // a path that was hashed before does not have to be read again while its texture is alive
+        auto known = contentOfPath.find(source);
+        if (known != contentOfPath.end())
+        {
+            auto entry = textures.find(known->second);
+            if (entry != textures.end())
+                if (shared_ptr<TextureHandle::Entry> live = entry->second.lock())
+                    return live;
+        }
+
+        FileContents data;
+        if (!Vfs::get().read(source, data))
+        {
+            std::cout << "Texture failed to load at path: " << source << std::endl;
+            return nullptr;
+        }
+        uint64_t hash = contentHash(data.data, data.size);
+        contentOfPath[source] = hash;
+
+        auto entry = textures.find(hash);
+        if (entry != textures.end())
+            if (shared_ptr<TextureHandle::Entry> live = entry->second.lock())
+                return live;
+
+        shared_ptr<TextureHandle::Entry> created = make_shared<TextureHandle::Entry>();
+        created->hash = hash;
+        created->id = TextureLoader::get().load2DFromMemory(source, std::move(data), nullptr, path);
+        textures[hash] = created;
+        return created;
+    }
+
+    // swaps the GL texture behind a live entry, the old one is deleted
+    void replace(const shared_ptr<TextureHandle::Entry> &entry, unsigned int texture, uint64_t hash)
+    {
+        auto old = textures.find(entry->hash);
+        if (old != textures.end() && old->second.lock() == entry)
+            textures.erase(old);
+        glDeleteTextures(1, &entry->id);
+        entry->id = texture;
+        entry->hash = hash;
+        auto same = textures.find(hash);
+        if (same == textures.end() || same->second.expired())
+            textures[hash] = entry;
+    }
+
+    void release(TextureHandle::Entry &entry)
+    {
+        if (closed)
+            return;
+        if (entry.id != 0)
+            glDeleteTextures(1, &entry.id);
+        auto it = textures.find(entry.hash);
+        if (it != textures.end() && it->second.expired())
+            textures.erase(it);
+    }
+};
+
+TextureHandle::Entry::~Entry()
+{
+    TextureRegistry::get().release(*this);
+}
+#endif
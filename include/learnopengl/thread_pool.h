@@ -0,0 +1,141 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads that run queued jobs in FIFO order.
+// Jobs must not touch OpenGL, the context is only current on the main thread.
+class ThreadPool
+{
+public:
+    // threadCount == 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0) : stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0)
+            threadCount = 1;
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void enqueue(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    unsigned int size() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    // runs body(begin, end) over [0, count) in chunks of about grain items and returns once all are done.
+    // The calling thread works on chunks too instead of only waiting, so this may be called from a job of the
+    // same pool (even nested) without deadlocking when every worker is busy.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body)
+    {
+        grain = std::max<size_t>(grain, 1);
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks <= 1)
+        {
+            if (count > 0)
+                body(0, count);
+            return;
+        }
+
+        // helpers may start after the call returned, everything they touch lives in the shared state
+        struct State {
+            std::function<void(size_t, size_t)> body;
+            size_t count, grain, chunks;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+
+            void run()
+            {
+                size_t chunk;
+                while ((chunk = next++) < chunks)
+                {
+                    size_t begin = chunk * grain;
+                    body(begin, std::min(count, begin + grain));
+                    if (++done == chunks)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        finished.notify_all();
+                    }
+                }
+            }
+        };
+        std::shared_ptr<State> state = std::make_shared<State>();
+        state->body = body;
+        state->count = count;
+        state->grain = grain;
+        state->chunks = chunks;
+
+        size_t helpers = std::min<size_t>(chunks - 1, size());
+        for (size_t i = 0; i < helpers; i++)
+            enqueue([state] { state->run(); });
+        state->run();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done == state->chunks; });
+    }
+
+    // process-wide pool shared by the asset loaders
+    static ThreadPool &shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+#endif
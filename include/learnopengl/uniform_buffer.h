@@ -0,0 +1,59 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <type_traits>
+
+// Uniform buffer holding one std140 block, the C++ mirror T of the GLSL block. The buffer is attached to its
+// binding point once at creation; programs declaring the block are pointed at that binding with
+// Shader::bindUniformBlock. update() uploads the whole block, one call per frame for data every program
+// shares (camera, lights) instead of setting the same uniforms on each program.
+//
+// T must match the std140 rules: vec3/vec4 and structs aligned to 16 bytes, a vec3 followed by a float
+// shares one 16 byte slot, arrays and structs are padded to 16 bytes. Mirrors check their offsets with
+// STD140_OFFSET next to the definition, so a layout change that breaks the match fails to compile.
+#define STD140_OFFSET(type, member, offset) \
+    static_assert(offsetof(type, member) == (offset), #type "::" #member " is not at its std140 offset")
+
+template <typename T>
+class UniformBuffer
+{
+public:
+    static_assert(std::is_standard_layout<T>::value, "uniform blocks are plain structs");
+    static_assert(sizeof(T) % 16 == 0, "std140 blocks are padded to a multiple of 16 bytes");
+
+    explicit UniformBuffer(GLuint binding) : binding(binding)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    // uploads the block, visible to every program bound to the binding point
+    void update(const T &block)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    GLuint getBinding() const { return binding; }
+
+    // deletes the buffer; not done on destruction, the owner calls it while the GL context still exists
+    void release()
+    {
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+    }
+
+private:
+    GLuint ID = 0;
+    GLuint binding;
+};
+#endif
@@ -0,0 +1,321 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <learnopengl/resource_archive.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Contents of one file read through the Vfs. A file served from the mounted archive is a slice of the
+// mapping (data points into it and storage is empty); a loose file is read into storage.
+// Move only, since data may point into storage.
+struct FileContents {
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    vector<unsigned char> storage;
+
+    FileContents() {}
+    FileContents(FileContents &&) = default;
+    FileContents &operator=(FileContents &&) = default;
+    FileContents(const FileContents &) = delete;
+    FileContents &operator=(const FileContents &) = delete;
+
+    bool empty() const
+    {
+        return size == 0;
+    }
+
+    string str() const
+    {
+        return data ? string((const char *)data, size) : string();
+    }
+};
+
+// Virtual file system in front of every resource read (shaders, textures, mesh caches, models).
+// With an archive mounted (see resource_archive.h and tools/pack_resources.cpp) files are looked up in it
+// first, so a packed scene starts with one mapped file instead of hundreds of small reads. Files that are not
+// in the archive are read from disk as before.
+//
+// Paths are given as usual (absolute from FileSystem::getPath or relative to the working directory); the
+// mount root is stripped so both resolve to the archive name, e.g. resources/objects/statue/statue.obj.
+// While recording, the name of every file read is kept so the pack tool can bundle exactly what a scene uses.
+class Vfs
+{
+public:
+    static Vfs &get()
+    {
+        static Vfs vfs;
+        return vfs;
+    }
+
+    // mounts the archive at archivePath, paths under root are looked up relative to it. Call before any
+    // read, the archive is not guarded against concurrent remounts.
+    bool mount(const string &archivePath, const string &root = "")
+    {
+        this->root = normalize(root);
+        if (!this->root.empty() && this->root.back() != '/')
+            this->root += '/';
+        return archive.open(archivePath);
+    }
+
+    bool isMounted() const
+    {
+        return archive.isOpen();
+    }
+
+    // reads a file; thread-safe
+    bool read(const string &path, FileContents &contents)
+    {
+        string name = relativeName(path);
+        contents.storage.clear();
+        if (archive.isOpen() && !isOverridden(name) && archive.find(name, contents.data, contents.size))
+        {
+            record(name);
+            return true;
+        }
+
+        contents.data = nullptr;
+        contents.size = 0;
+        ifstream in(path, ios::binary | ios::ate);
+        if (!in)
+            return false;
+        contents.storage.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read((char *)contents.storage.data(), contents.storage.size());
+        if (!in)
+            return false;
+        contents.data = contents.storage.data();
+        contents.size = contents.storage.size();
+        record(name);
+        return true;
+    }
+
+    // archive slice only, for callers that map loose files themselves (MeshCache)
+    bool findInArchive(const string &path, const unsigned char *&data, size_t &size)
+    {
+        if (!archive.isOpen())
+            return false;
+        string name = relativeName(path);
+        if (isOverridden(name) || !archive.find(name, data, size))
+            return false;
+        record(name);
+        return true;
+    }
+
+    bool inArchive(const string &path) const
+    {
+        const unsigned char *data;
+        size_t size;
+        string name = relativeName(path);
+        return archive.isOpen() && !isOverridden(name) && archive.find(name, data, size);
+    }
+
+    // the file changed on disk (hot reload): from now on it is read from disk even if it is in the archive
+    void overrideWithLooseFile(const string &path)
+    {
+        lock_guard<mutex> lock(overrideMutex);
+        overridden.insert(relativeName(path));
+        hasOverrides = true;
+    }
+
+    // whether path was overridden with its loose file, i.e. changed on disk since the archive was packed
+    bool isLoose(const string &path) const
+    {
+        return isOverridden(relativeName(path));
+    }
+
+    bool exists(const string &path) const
+    {
+        if (inArchive(path))
+            return true;
+        ifstream in(path, ios::binary);
+        return (bool)in;
+    }
+
+    // for files read around the Vfs (e.g. mapped directly), so they still end up in the manifest
+    void recordRead(const string &path)
+    {
+        record(relativeName(path));
+    }
+
+    // starts collecting the names of all files read
+    void setRecording(bool enabled)
+    {
+        lock_guard<mutex> lock(recordMutex);
+        recording = enabled;
+    }
+
+    // names of the files read since recording started, one per line
+    bool saveManifest(const string &path)
+    {
+        lock_guard<mutex> lock(recordMutex);
+        ofstream out(path, ios::trunc);
+        if (!out)
+            return false;
+        for (const string &name : recorded)
+            out << name << '\n';
+        return (bool)out;
+    }
+
+    // path relative to the mount root with '/' separators and no "." or ".." components
+    string relativeName(const string &path) const
+    {
+        string name = normalize(path);
+        if (!root.empty() && name.compare(0, root.size(), root) == 0)
+            name.erase(0, root.size());
+        return name;
+    }
+
+    static string normalize(const string &path)
+    {
+        string p = path;
+        for (char &c : p)
+            if (c == '\\')
+                c = '/';
+        bool absolute = !p.empty() && p[0] == '/';
+
+        vector<string> parts;
+        size_t start = 0;
+        while (start <= p.size())
+        {
+            size_t end = p.find('/', start);
+            if (end == string::npos)
+                end = p.size();
+            string part = p.substr(start, end - start);
+            if (part == "..")
+            {
+                if (!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else if (!absolute)
+                    parts.push_back(part);
+            }
+            else if (!part.empty() && part != ".")
+                parts.push_back(part);
+            start = end + 1;
+        }
+
+        string result = absolute ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            if (i > 0)
+                result += '/';
+            result += parts[i];
+        }
+        return result;
+    }
+
+private:
+    ResourceArchive archive;
+    string root;
+
+    mutable mutex overrideMutex;
+    atomic<bool> hasOverrides{false};
+    set<string> overridden;
+
+    mutex recordMutex;
+    bool recording = false;
+    set<string> recorded;
+
+    Vfs() {}
+
+    bool isOverridden(const string &name) const
+    {
+        if (!hasOverrides)
+            return false;
+        lock_guard<mutex> lock(overrideMutex);
+        return overridden.count(name) != 0;
+    }
+
+    void record(const string &name)
+    {
+        lock_guard<mutex> lock(recordMutex);
+        if (recording)
+            recorded.insert(name);
+    }
+};
+
+// A file in memory for loaders that parse large files in place (ObjLoader, GltfLoader): a slice of the mounted
+// archive, or else the loose file mapped with mmap. Nothing is copied either way. Move only.
+class MappedFile
+{
+public:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    MappedFile(MappedFile &&other) : data(other.data), size(other.size), mapping(other.mapping)
+    {
+        other.data = nullptr;
+        other.size = 0;
+        other.mapping = nullptr;
+    }
+
+    MappedFile &operator=(MappedFile &&other)
+    {
+        if (this != &other)
+        {
+            close();
+            std::swap(data, other.data);
+            std::swap(size, other.size);
+            std::swap(mapping, other.mapping);
+        }
+        return *this;
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // false for missing or empty files
+    bool open(const string &path)
+    {
+        close();
+        if (Vfs::get().findInArchive(path, data, size))
+            return size > 0;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps its own reference to the file
+        if (mapped == MAP_FAILED)
+            return false;
+        madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+        mapping = mapped;
+        data = (const unsigned char *)mapped;
+        size = (size_t)st.st_size;
+        Vfs::get().recordRead(path);
+        return true;
+    }
+
+    void close()
+    {
+        if (mapping)
+            munmap(mapping, size);
+        mapping = nullptr;
+        data = nullptr;
+        size = 0;
+    }
+
+private:
+    void *mapping = nullptr; // null for archive slices
+};
+#endif
@@ -0,0 +1,95 @@
+#ifndef VFS_IO_SYSTEM_H
+#define VFS_IO_SYSTEM_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+// Lets Assimp read models (and the files they reference, e.g. .mtl) through the Vfs, so a model packed into
+// the archive is parsed straight from the mapping. Read only.
+class VfsIOStream : public Assimp::IOStream
+{
+public:
+    explicit VfsIOStream(FileContents contents) : contents(std::move(contents)), position(0) {}
+
+    size_t Read(void *buffer, size_t size, size_t count) override
+    {
+        if (size == 0)
+            return 0;
+        size_t items = std::min(count, (contents.size - position) / size);
+        memcpy(buffer, contents.data + position, items * size);
+        position += items * size;
+        return items;
+    }
+
+    size_t Write(const void *buffer, size_t size, size_t count) override
+    {
+        return 0;
+    }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override
+    {
+        size_t target;
+        if (origin == aiOrigin_SET)
+            target = offset;
+        else if (origin == aiOrigin_CUR)
+            target = position + offset;
+        else
+            target = contents.size - offset;
+        if (target > contents.size)
+            return aiReturn_FAILURE;
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override
+    {
+        return position;
+    }
+
+    size_t FileSize() const override
+    {
+        return contents.size;
+    }
+
+    void Flush() override {}
+
+private:
+    FileContents contents;
+    size_t position;
+};
+
+class VfsIOSystem : public Assimp::IOSystem
+{
+public:
+    bool Exists(const char *path) const override
+    {
+        return Vfs::get().exists(path);
+    }
+
+    char getOsSeparator() const override
+    {
+        return '/';
+    }
+
+    Assimp::IOStream *Open(const char *path, const char *mode = "rb") override
+    {
+        if (strchr(mode, 'w') || strchr(mode, 'a'))
+            return nullptr;
+        FileContents contents;
+        if (!Vfs::get().read(path, contents))
+            return nullptr;
+        return new VfsIOStream(std::move(contents));
+    }
+
+    void Close(Assimp::IOStream *stream) override
+    {
+        delete stream;
+    }
+};
+#endif
@@ -49,13 +49,20 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLight0;
-uniform PointLight pointLight1;
-uniform PointLight pointLight2;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+// the light set, std140 mirrors of these structs are in main.cpp
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLight0;
+    PointLight pointLight1;
+    PointLight pointLight2;
+    SpotLight spotLight;
+};
 
-uniform SpotLight spotLight;
 uniform Material material;
 
 // function prototypes
@@ -9,12 +9,20 @@ out vec2 TexCoords;
 
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame camera data, one uniform buffer shared by every program
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+// position decode of packed (quantized) vertices, identity for float vertices
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = positionOffset + aPos * positionScale;
+    FragPos = vec3(model * vec4(position, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
     TexCoords = aTexCoords;
     gl_Position = projection * view * vec4(FragPos, 1.0);
@@ -12,15 +12,12 @@ in VS_OUT {
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
 void main()
 {           
      // obtain normal from normal map in range [0,1]
-    vec3 normal = texture(normalMap, fs_in.TexCoords).rgb;
-    // transform normal vector to range [-1,1]
-    normal = normalize(normal * 2.0 - 1.0);  // this normal is in tangent space
+    // transform normal vector to range [-1,1], z is reconstructed so baked two channel (BC5) maps work too
+    vec2 normalXY = texture(normalMap, fs_in.TexCoords).rg * 2.0 - 1.0;
+    vec3 normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));  // this normal is in tangent space
    
     // get diffuse color
     vec3 color = texture(diffuseMap, fs_in.TexCoords).rgb;
@@ -68,8 +68,9 @@ void main()
         discard;
 
     // obtain normal from normal map
-    vec3 normal = texture(normalMap, texCoords).rgb;
-    normal = normalize(normal * 2.0 - 1.0);
+    // z is reconstructed so baked two channel (BC5) normal maps work too
+    vec2 normalXY = texture(normalMap, texCoords).rg * 2.0 - 1.0;
+    vec3 normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
 
     // get diffuse color
     vec3 color = texture(diffuseMap, texCoords).rgb;
@@ -10,9 +10,18 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <learnopengl/filesystem.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/hot_reload.h>
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/model_loader.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/startup_profiler.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/uniform_buffer.h>
+#include <learnopengl/vfs.h>
 
 #include <iostream>
 
@@ -26,19 +35,36 @@ void processInput(GLFWwindow *window);
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
-void set_spotLight(Shader& shader);
+struct SpotLight;
+SpotLight get_spotLight();
 
 void renderQuad();
 void renderQuad1();
 void renderCube();
+unsigned int quadVertexArray();
+unsigned int cubeVertexArray();
 
 unsigned int loadCubemap(vector<std::string> faces);
-unsigned int loadTexture(const char *path);
+TextureHandle loadTexture(const char *path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 float heightScale = 0.005f;
+// textures start as 1x1 placeholders and are streamed in over the first frames
+const bool STREAM_TEXTURES = true;
+const size_t TEXTURE_STREAM_BYTES_PER_FRAME = 8 * 1024 * 1024;
+// resources are read from this archive when it exists (built by pack_resources from the manifest below)
+const char *const RESOURCE_ARCHIVE = "resources/scene.pak";
+// writes the list of files the scene reads on exit, the input of pack_resources
+const bool RECORD_RESOURCE_MANIFEST = false;
+const char *const RESOURCE_MANIFEST = "resources/scene.manifest";
+// changed shaders, textures and models under resources/ are reloaded while running, spending at most
+// about this much time per frame on it
+const bool HOT_RELOAD = true;
+const double HOT_RELOAD_FRAME_BUDGET_MS = 2.0;
+// startup timings, written once all textures are uploaded
+const char *const STARTUP_PROFILE = "startup_profile.json";
 
 // camera
 
@@ -84,6 +110,111 @@ struct SpotLight {
     glm::vec3 specular;
 };
 
+// std140 mirrors of the uniform blocks in the shaders (Camera in every scene shader, Lights in
+// 2.model_lighting.fs), uploaded once per frame
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+
+struct CameraBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float pad0;
+};
+STD140_OFFSET(CameraBlock, view, 64);
+STD140_OFFSET(CameraBlock, viewPos, 128);
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock doesn't match the std140 layout of Camera");
+
+struct DirLightStd140 {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+
+    DirLightStd140(const DirLight& light)
+        : direction(light.direction), pad0(0), ambient(light.ambient), pad1(0), diffuse(light.diffuse), pad2(0),
+          specular(light.specular), pad3(0) {}
+};
+STD140_OFFSET(DirLightStd140, ambient, 16);
+STD140_OFFSET(DirLightStd140, diffuse, 32);
+STD140_OFFSET(DirLightStd140, specular, 48);
+static_assert(sizeof(DirLightStd140) == 64, "DirLightStd140 doesn't match the std140 layout of DirLight");
+
+// the floats fill the padding after the vec3s, in the order of the GLSL struct
+struct PointLightStd140 {
+    glm::vec3 position;
+    float constant;
+    float linear;
+    float quadratic;
+    float pad0[2];
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+
+    PointLightStd140(const PointLight& light)
+        : position(light.position), constant(light.constant), linear(light.linear), quadratic(light.quadratic),
+          pad0{0, 0}, ambient(light.ambient), pad1(0), diffuse(light.diffuse), pad2(0), specular(light.specular), pad3(0) {}
+};
+STD140_OFFSET(PointLightStd140, constant, 12);
+STD140_OFFSET(PointLightStd140, linear, 16);
+STD140_OFFSET(PointLightStd140, quadratic, 20);
+STD140_OFFSET(PointLightStd140, ambient, 32);
+STD140_OFFSET(PointLightStd140, diffuse, 48);
+STD140_OFFSET(PointLightStd140, specular, 64);
+static_assert(sizeof(PointLightStd140) == 80, "PointLightStd140 doesn't match the std140 layout of PointLight");
+
+struct SpotLightStd140 {
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+
+    SpotLightStd140(const SpotLight& light)
+        : position(light.position), pad0(0), direction(light.direction), cutOff(light.cutOff), outerCutOff(light.outerCutOff),
+          constant(light.constant), linear(light.linear), quadratic(light.quadratic), ambient(light.ambient), pad1(0),
+          diffuse(light.diffuse), pad2(0), specular(light.specular), pad3(0) {}
+};
+STD140_OFFSET(SpotLightStd140, direction, 16);
+STD140_OFFSET(SpotLightStd140, cutOff, 28);
+STD140_OFFSET(SpotLightStd140, outerCutOff, 32);
+STD140_OFFSET(SpotLightStd140, constant, 36);
+STD140_OFFSET(SpotLightStd140, linear, 40);
+STD140_OFFSET(SpotLightStd140, quadratic, 44);
+STD140_OFFSET(SpotLightStd140, ambient, 48);
+STD140_OFFSET(SpotLightStd140, diffuse, 64);
+STD140_OFFSET(SpotLightStd140, specular, 80);
+static_assert(sizeof(SpotLightStd140) == 96, "SpotLightStd140 doesn't match the std140 layout of SpotLight");
+
+struct LightsBlock {
+    DirLightStd140 dirLight;
+    PointLightStd140 pointLight0;
+    PointLightStd140 pointLight1;
+    PointLightStd140 pointLight2;
+    SpotLightStd140 spotLight;
+};
+STD140_OFFSET(LightsBlock, pointLight0, 64);
+STD140_OFFSET(LightsBlock, pointLight1, 144);
+STD140_OFFSET(LightsBlock, pointLight2, 224);
+STD140_OFFSET(LightsBlock, spotLight, 304);
+static_assert(sizeof(LightsBlock) == 400, "LightsBlock doesn't match the std140 layout of Lights");
+
 struct ProgramState {
     glm::vec3 clearColor = glm::vec3(0);
     bool ImGuiEnabled = false;
@@ -137,6 +268,9 @@ void ProgramState::LoadFromFile(std::string filename) {
 
 ProgramState *programState;
 bool spotLightActivated=false;
+// counters of the scene pass of the last frame, shown in the ImGui window
+RenderQueueStats renderQueueStats;
+GLStateStats glStateStats;
 bool bloom = false;
 bool bloomKeyPressed = false;
 float exposure = 0.5f;
@@ -148,8 +282,16 @@ bool blurKeyPressed=false;
 void DrawImGui(ProgramState *programState);
 
 int main() {
+    StartupProfiler &profiler = StartupProfiler::get();
+    double phaseStart = profiler.nowMs();
+    if (Vfs::get().mount(FileSystem::getPath(RESOURCE_ARCHIVE), FileSystem::getPath("")))
+        std::cout << "Resource archive mounted: " << RESOURCE_ARCHIVE << std::endl;
+    Vfs::get().setRecording(RECORD_RESOURCE_MANIFEST);
+    profiler.recordSince("phase", "mount archive", phaseStart);
+
     // glfw: initialize and configure
     // ------------------------------
+    phaseStart = profiler.nowMs();
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -175,13 +317,18 @@ int main() {
     glfwSetKeyCallback(window, key_callback);
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    profiler.recordSince("phase", "window", phaseStart);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
+    phaseStart = profiler.nowMs();
     if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // linked shader programs are cached on disk, warm starts skip compiling them
+    ProgramBinaryCache::get().init((GLADloadproc) glfwGetProcAddress);
+    profiler.recordSince("phase", "glad", phaseStart);
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     //stbi_set_flip_vertically_on_load(true);
@@ -203,13 +350,17 @@ int main() {
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState &gl = GLState::get();
+    gl.enable(GL_DEPTH_TEST);
+    gl.enable(GL_MULTISAMPLE);
+    gl.enable(GL_CULL_FACE);
+    gl.enable(GL_BLEND);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    TextureLoader::get().setStreaming(STREAM_TEXTURES, TEXTURE_STREAM_BYTES_PER_FRAME);
 
     // build and compile shaders
+    phaseStart = profiler.nowMs();
     Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
     Shader skyboxShader("resources/shaders/skybox.vs","resources/shaders/skybox.fs");
 
@@ -223,13 +374,55 @@ int main() {
     Shader shaderBlur("resources/shaders/blur.vs", "resources/shaders/blur.fs");
     Shader shaderBloomFinal("resources/shaders/bloom_final.vs", "resources/shaders/bloom_final.fs");
     Shader b2Shader("resources/shaders/blending2.vs", "resources/shaders/blending2.fs");
-
-    Model statuaModel("resources/objects/LibertyStatue/LibertStatue.obj");
-    Model postoljeModel("resources/objects/10421_square_pedastal_iterations-2.obj");
+    profiler.recordSince("phase", "shaders", phaseStart);
+
+    UniformBuffer<CameraBlock> cameraBuffer(CAMERA_BLOCK_BINDING);
+    UniformBuffer<LightsBlock> lightsBuffer(LIGHTS_BLOCK_BINDING);
+    for (Shader *shader : {&ourShader, &skyboxShader, &lightingShader, &normalShader, &parallaxShader, &blendingShader,
+                           &shaderBloom, &b2Shader})
+        shader->bindUniformBlock("Camera", cameraBuffer.getBinding());
+    ourShader.bindUniformBlock("Lights", lightsBuffer.getBinding());
+    UniformHandle<glm::mat4> modelUniform = ourShader.uniform<glm::mat4>("model");
+    UniformHandle<glm::mat4> blendingModelUniform = blendingShader.uniform<glm::mat4>("model");
+    UniformHandle<glm::mat4> b2ModelUniform = b2Shader.uniform<glm::mat4>("model");
+    UniformHandle<glm::mat4> normalModelUniform = normalShader.uniform<glm::mat4>("model");
+    UniformHandle<glm::mat4> parallaxModelUniform = parallaxShader.uniform<glm::mat4>("model");
+    UniformHandle<glm::mat4> lightingModelUniform = lightingShader.uniform<glm::mat4>("model");
+    UniformHandle<glm::mat4> bloomModelUniform = shaderBloom.uniform<glm::mat4>("model");
+    RenderQueue renderQueue;
+    profiler.setValue("program_binary_cache_hits", ProgramBinaryCache::get().hits);
+
+    ModelOptions modelOptions;
+    modelOptions.weldVertices = true;
+    modelOptions.optimizeMeshes = true;
+    modelOptions.vertexFormat = VERTEX_FORMAT_PACKED;
+    modelOptions.sharedBuffers = true;
+    modelOptions.lodLevels = 3;
+    modelOptions.buildMeshlets = true;
+    modelOptions.nativeTangentSpace = true;
+    modelOptions.nativeObjLoader = true;
+    // nothing reads the geometry on the CPU after upload except culling
+    modelOptions.geometryRetention = GEOMETRY_BOUNDS_ONLY;
+    phaseStart = profiler.nowMs();
+    vector<unique_ptr<Model>> models = ModelLoader::load({"resources/objects/LibertyStatue/LibertStatue.obj",
+                                                          "resources/objects/10421_square_pedastal_iterations-2.obj"}, modelOptions);
+    Model &statuaModel = *models[0];
+    Model &postoljeModel = *models[1];
+    profiler.recordSince("phase", "models", phaseStart);
+    profiler.setValue("models_from_mesh_cache", (statuaModel.loadedFromCache ? 1 : 0) + (postoljeModel.loadedFromCache ? 1 : 0));
 
     statuaModel.SetShaderTextureNamePrefix("material.");
     postoljeModel.SetShaderTextureNamePrefix("material.");
 
+    HotReloader hotReloader(HOT_RELOAD_FRAME_BUDGET_MS);
+    if (HOT_RELOAD && hotReloader.start(FileSystem::getPath("resources"))) {
+        for (Shader *shader : {&ourShader, &skyboxShader, &lightingShader, &normalShader, &parallaxShader, &blendingShader,
+                               &shaderBloom, &shaderBlur, &shaderBloomFinal, &b2Shader})
+            hotReloader.watch(*shader);
+        hotReloader.watch(statuaModel);
+        hotReloader.watch(postoljeModel);
+    }
+
     float cubeVertices[] = {
             // positions          // texture Coords
             -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
@@ -495,17 +688,28 @@ int main() {
             };
 
 
+    phaseStart = profiler.nowMs();
     unsigned int cubemapTexture = loadCubemap(faces);
 
-    unsigned int n_diffuseMap = loadTexture(FileSystem::getPath("resources/textures/marble_01_diff_4k.jpg").c_str());
-    unsigned int n_normalMap  = loadTexture(FileSystem::getPath("resources/textures/marble_01_nor_gl_4k.jpg").c_str());
+    TextureHandle n_diffuseMap = loadTexture(FileSystem::getPath("resources/textures/marble_01_diff_4k.jpg").c_str());
+    TextureHandle n_normalMap = loadTexture(FileSystem::getPath("resources/textures/marble_01_nor_gl_4k.jpg").c_str());
 
-    unsigned int p_diffuseMap = loadTexture(FileSystem::getPath("resources/textures/floor_tiles_08_diff_4k.jpg").c_str());
-    unsigned int p_normalMap = loadTexture(FileSystem::getPath("resources/textures/floor_tiles_08_nor_gl_4k.jpg").c_str());
-    unsigned int p_heightMap = loadTexture(FileSystem::getPath("resources/textures/floor_tiles_08_disp_4k.jpg").c_str());
+    TextureHandle p_diffuseMap = loadTexture(FileSystem::getPath("resources/textures/floor_tiles_08_diff_4k.jpg").c_str());
+    TextureHandle p_normalMap = loadTexture(FileSystem::getPath("resources/textures/floor_tiles_08_nor_gl_4k.jpg").c_str());
+    TextureHandle p_heightMap = loadTexture(FileSystem::getPath("resources/textures/floor_tiles_08_disp_4k.jpg").c_str());
 
-    unsigned int transparentTexture = loadTexture(FileSystem::getPath("resources/textures/11_ccexpress.png").c_str());
-    unsigned int windowTexture = loadTexture(FileSystem::getPath("resources/textures/window.png").c_str());
+    TextureHandle transparentTexture = loadTexture(FileSystem::getPath("resources/textures/11_ccexpress.png").c_str());
+    TextureHandle windowTexture = loadTexture(FileSystem::getPath("resources/textures/window.png").c_str());
+
+    // every image of the scene is decoding in parallel by now, upload them as they finish
+    // (when streaming, the render loop uploads them a few megabytes per frame instead)
+    profiler.recordSince("phase", "texture requests", phaseStart);
+    if (!TextureLoader::get().isStreaming()) {
+        phaseStart = profiler.nowMs();
+        TextureLoader::get().finish();
+        profiler.recordSince("phase", "texture finish", phaseStart);
+    }
+    profiler.setValue("texture_streaming", TextureLoader::get().isStreaming() ? 1 : 0);
 
 
     vector<glm::vec3> vegetation
@@ -530,6 +734,9 @@ int main() {
 
 
 
+    ourShader.use();
+    ourShader.setFloat("material.shininess", 32.0f);
+
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
@@ -554,6 +761,9 @@ int main() {
     b2Shader.use();
     b2Shader.setInt("texture1", 0);
 
+    shaderBloom.use();
+    shaderBloom.setVec3("lightColor", glm::vec3(8.5f,  8.0f, 1.0f));
+
     PointLight& pointLight0 = programState->pointLight0;
     pointLight0.position = glm::vec3(pointLightPositions[0]);
     pointLight0.ambient = glm::vec3(0.6, 0.6, 0.6);
@@ -606,6 +816,16 @@ int main() {
         // input
         // -----
         processInput(window);
+
+        // between frames: swap in reloaded assets
+        hotReloader.update();
+        if (TextureLoader::get().isStreaming())
+            TextureLoader::get().update();
+        else
+            TextureLoader::get().uploadReady(); // hot reloaded textures
+        // the above binds through raw GL calls; from here on state changes go through GLState
+        gl.invalidate();
+        gl.resetStats();
         // render
 
 //        glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
@@ -614,75 +834,51 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         // 1. render scene into floating point framebuffer
         // -----------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+        gl.bindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        ourShader.use();
         pointLight0.position=pointLightPositions[0];
-        ourShader.setVec3("dirLight.direction",dirLight.direction );
-        ourShader.setFloat("material.shininess", 32.0f);
-
-        ourShader.setVec3("dirLight.ambient",dirLight.ambient );
-        ourShader.setVec3("dirLight.diffuse",  dirLight.diffuse);
-        ourShader.setVec3("dirLight.specular", dirLight.specular);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-
-
-        ourShader.setVec3("pointLight0.position", pointLight0.position);
-        ourShader.setVec3("pointLight0.ambient", pointLight0.ambient);
-        ourShader.setVec3("pointLight0.diffuse", pointLight0.diffuse);
-        ourShader.setVec3("pointLight0.specular", pointLight0.specular);
-        ourShader.setFloat("pointLight0.constant", pointLight0.constant);
-        ourShader.setFloat("pointLight0.linear", pointLight0.linear);
-        ourShader.setFloat("pointLight0.quadratic", pointLight0.quadratic);
-
-        ourShader.setVec3("pointLight1.position", pointLight1.position);
-        ourShader.setVec3("pointLight1.ambient", pointLight1.ambient);
-        ourShader.setVec3("pointLight1.diffuse", pointLight1.diffuse);
-        ourShader.setVec3("pointLight1.specular", pointLight1.specular);
-        ourShader.setFloat("pointLight1.constant", pointLight1.constant);
-        ourShader.setFloat("pointLight1.linear", pointLight1.linear);
-        ourShader.setFloat("pointLight1.quadratic", pointLight1.quadratic);
-
-        ourShader.setVec3("pointLight2.position", pointLight2.position);
-        ourShader.setVec3("pointLight2.ambient", pointLight2.ambient);
-        ourShader.setVec3("pointLight2.diffuse", pointLight2.diffuse);
-        ourShader.setVec3("pointLight2.specular", pointLight2.specular);
-        ourShader.setFloat("pointLight2.constant", pointLight2.constant);
-        ourShader.setFloat("pointLight2.linear", pointLight2.linear);
-        ourShader.setFloat("pointLight2.quadratic", pointLight2.quadratic);
-
-        set_spotLight(ourShader);
-
         glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
                                                 (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
+        // camera and lights for every program, one upload each
+        CameraBlock cameraBlock = {projection, view, programState->camera.Position, 0.0f};
+        cameraBuffer.update(cameraBlock);
+        LightsBlock lightsBlock = {dirLight, pointLight0, pointLight1, pointLight2, get_spotLight()};
+        lightsBuffer.update(lightsBlock);
+
+        // per-frame uniforms of the programs, the draws themselves go through the render queue
+        glm :: vec3 p;
+        if (bloom){
+            p=pointLight2.position;
+        }
+        else{
+            p=pointLight0.position;
+        }
+        normalShader.use();
+        normalShader.setVec3("lightPos",p );
+        parallaxShader.use();
+        parallaxShader.setVec3("lightPos",p );
+        parallaxShader.setFloat("heightScale", heightScale);
+
+        renderQueue.begin(view, 100.0f);
 
         // render the loaded model
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model,programState->statuePosition); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(programState->statueScale));// it's a bit too big for our scene, so scale it down
         model = glm::rotate(model, glm::radians(currentFrame*50.0f),glm::vec3(0.0f,1.0f,0.0f));// it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        statuaModel.Draw(ourShader);
+        statuaModel.PrepareDraw(model, view, projection, (float)SCR_HEIGHT, GL_FRONT, GL_CW);
+        renderQueue.addModel(ourShader, modelUniform, statuaModel, model, RENDER_LAYER_OPAQUE, RENDER_CULL_FRONT);
 
         // render the loaded model(Postolje)
         model = glm::mat4(1.0f);
         model = glm::translate(model,programState->pedestalPosition); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(programState->pedestalScale));// it's a bit too big for our scene, so scale it down
         model = glm::rotate(model, glm::radians(90.0f),glm::vec3(1.0f,0.0f,0.0f));
-        ourShader.setMat4("model", model);
-        postoljeModel.Draw(ourShader);
-
-        blendingShader.use();
-        blendingShader.setMat4("projection",projection);
-        blendingShader.setMat4("view",view);
+        postoljeModel.PrepareDraw(model, view, projection, (float)SCR_HEIGHT, GL_FRONT, GL_CW);
+        renderQueue.addModel(ourShader, modelUniform, postoljeModel, model, RENDER_LAYER_OPAQUE, RENDER_CULL_FRONT);
 
-        glDisable(GL_CULL_FACE);
-        glBindVertexArray(transparentVAO);
-        glBindTexture(GL_TEXTURE_2D, transparentTexture);
         for (unsigned int i = 0; i < vegetation.size(); i++)
         {
 
@@ -690,51 +886,16 @@ int main() {
             model = glm::translate(model, vegetation[i]);
             model = glm::scale(model, glm::vec3(0.5f));
 
-            blendingShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            renderQueue.addArrays(blendingShader, blendingModelUniform, model, transparentVAO, GL_TRIANGLES, 0, 6,
+                                  RENDER_LAYER_TRANSPARENT, RENDER_CULL_NONE).texture(transparentTexture.id());
         }
-        glEnable(GL_CULL_FACE);
 
-        b2Shader.use();
         model = glm::mat4(1.0f);
-        b2Shader.setMat4("projection", projection);
-        b2Shader.setMat4("view", view);
-
-        glDisable(GL_CULL_FACE);
-        glBindVertexArray(blendingVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, windowTexture);
         model = glm::translate(model, programState->statuePosition+glm::vec3(0.0,0.37,0.0));
         model = glm::scale(model,glm::vec3(0.3,0.75,0.3));
-        b2Shader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glEnable(GL_CULL_FACE);
+        renderQueue.addArrays(b2Shader, b2ModelUniform, model, blendingVAO, GL_TRIANGLES, 0, 36,
+                              RENDER_LAYER_TRANSPARENT, RENDER_CULL_NONE).texture(windowTexture.id());
 
-        normalShader.use();
-        normalShader.setMat4("projection", projection);
-        normalShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-
-        model = glm::translate(model,glm::vec3(0.0f,-0.5,1.40));
-        model = glm::scale(model, glm::vec3(0.7f));
-        model = glm::rotate(model, glm::radians(90.0f), glm::normalize(glm::vec3(1.0, 0.0, 0.0))); // rotate the quad to show normal mapping from multiple directions
-        model = glm::rotate(model, glm::radians(180.0f),glm::normalize(glm::vec3(0.0f,1.0f,.0f)));
-        normalShader.setMat4("model", model);
-        normalShader.setVec3("viewPos", programState->camera.Position);
-        glm :: vec3 p;
-        if (bloom){
-            p=pointLight2.position;
-        }
-        else{
-            p=pointLight0.position;
-        }
-        normalShader.setVec3("lightPos",p );
-
-        glDisable(GL_CULL_FACE);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, n_diffuseMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, n_normalMap);
         for(unsigned int i=0;i < brickPos.size();i++) {
             model = glm::mat4(1.0f);
             model = glm::translate(model, brickPos[i]);
@@ -742,42 +903,21 @@ int main() {
             model = glm::rotate(model, glm::radians(180.0f),glm::normalize(glm::vec3(0.0f,1.0f,.0f)));
             model = glm::scale(model, glm::vec3(0.7f));
 
-            normalShader.setMat4("model", model);
-            renderQuad();
+            renderQueue.addArrays(normalShader, normalModelUniform, model, quadVertexArray(), GL_TRIANGLES, 0, 6,
+                                  RENDER_LAYER_OPAQUE, RENDER_CULL_NONE).texture(n_diffuseMap.id()).texture(n_normalMap.id());
         }
-        glEnable(GL_CULL_FACE);
 
-        parallaxShader.use();
-        parallaxShader.setMat4("projection", projection);
-        parallaxShader.setMat4("view", view);
         model = glm::mat4(1.0f);
         model = glm::translate(model,glm::vec3(0.0f,-0.5,0));
         model = glm::scale(model, glm::vec3(0.7f));
         model = glm::rotate(model, glm::radians(90.0f),glm::normalize(glm::vec3(1.0f,0.0f,.0f)));
         model = glm::rotate(model, glm::radians(180.0f),glm::normalize(glm::vec3(0.0f,1.0f,.0f)));
-        parallaxShader.setMat4("model", model);
-        parallaxShader.setVec3("viewPos", programState->camera.Position);
-        parallaxShader.setVec3("lightPos",p );
-        parallaxShader.setFloat("heightScale", heightScale);
-
-        glDisable(GL_CULL_FACE);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, p_diffuseMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, p_normalMap);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, p_heightMap);
-        renderQuad();
-        glEnable(GL_CULL_FACE);
+        renderQueue.addArrays(parallaxShader, parallaxModelUniform, model, quadVertexArray(), GL_TRIANGLES, 0, 6,
+                              RENDER_LAYER_OPAQUE, RENDER_CULL_NONE)
+                .texture(p_diffuseMap.id()).texture(p_normalMap.id()).texture(p_heightMap.id());
 
 //drawing a light cubes(light bulbs)
-        lightingShader.use();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
         // we now draw as many light bulbs as we have point lights.
-        glCullFace(GL_BACK);
-        glBindVertexArray(cubeVAO);
         for (unsigned int i = 0; i < 2; i++)
         {
             model = glm::mat4(1.0f);
@@ -789,42 +929,25 @@ int main() {
 
             model = glm::translate(model, pos);
             model = glm::scale(model, glm::vec3(0.5f)); // Make it a smaller cube
-            lightingShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            renderQueue.addArrays(lightingShader, lightingModelUniform, model, cubeVAO, GL_TRIANGLES, 0, 36,
+                                  RENDER_LAYER_OPAQUE, RENDER_CULL_BACK);
         }
 // drawing a bloom light bulb
-        shaderBloom.use();
-        shaderBloom.setMat4("projection", projection);
-        shaderBloom.setMat4("view", view);
         // world transformation
         model = glm::mat4(1.0f);
         model = glm::translate(model,glm::vec3( pointLight2.position));
         model = glm::scale(model, glm::vec3(0.3f)); // a smaller cube
-        shaderBloom.setMat4("model", model);
-        shaderBloom.setVec3("lightColor", glm::vec3(8.5f,  8.0f, 1.0f));
-        glDisable(GL_CULL_FACE);
-        renderCube();
-//        glBindVertexArray(cubeVAO);
-//        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glEnable(GL_CULL_FACE);
-
-        glCullFace(GL_FRONT);
-
- // draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        renderQueue.addArrays(shaderBloom, bloomModelUniform, model, cubeVertexArray(), GL_TRIANGLES, 0, 36,
+                              RENDER_LAYER_OPAQUE, RENDER_CULL_NONE);
+
+ // draw skybox after the opaque geometry, where nothing else was drawn (depth test GL_LEQUAL at the far plane)
+        renderQueue.addArrays(skyboxShader, UniformHandle<glm::mat4>(), glm::mat4(1.0f), skyboxVAO, GL_TRIANGLES, 0, 36,
+                              RENDER_LAYER_SKY, RENDER_CULL_FRONT).texture(cubemapTexture, GL_TEXTURE_CUBE_MAP);
+
+        renderQueue.submit();
+        renderQueueStats = renderQueue.getStats();
+
+        gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 // 2. blur bright fragments with two-pass Gaussian Blur
         bool horizontal = true, first_iteration = true;
@@ -832,27 +955,26 @@ int main() {
         shaderBlur.use();
         for (unsigned int i = 0; i < amount; i++)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+            gl.bindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
             shaderBlur.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
+            gl.bindTexture(0, GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
             renderQuad1();
             horizontal = !horizontal;
             if (first_iteration)
                 first_iteration = false;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderBloomFinal.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
+        gl.bindTexture(0, GL_TEXTURE_2D, colorBuffers[0]);
+        gl.bindTexture(1, GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
         shaderBloomFinal.setInt("bloom", bloom);
         shaderBloomFinal.setFloat("exposure", exposure);
         shaderBloomFinal.setInt("ind", ind);
         renderQuad1();
+        glStateStats = gl.getStats();
 
 
 
@@ -863,6 +985,14 @@ int main() {
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
+        // startup ends with the first frame that has every texture
+        if (!profiler.isFinished() && TextureLoader::get().idle()) {
+            profiler.setValue("uniform_lookup_misses", ourShader.getMissedLookups());
+            profiler.finish();
+            profiler.report(std::cout);
+            if (!profiler.writeJson(STARTUP_PROFILE))
+                std::cout << "Failed to write " << STARTUP_PROFILE << std::endl;
+        }
         glfwPollEvents();
     }
 
@@ -873,6 +1003,12 @@ int main() {
     ImGui::DestroyContext();
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteBuffers(1, &skyboxVBO);
+    cameraBuffer.release();
+    lightsBuffer.release();
+    // textures still referenced by the models are released after the context is gone
+    TextureRegistry::get().shutdown();
+    if (RECORD_RESOURCE_MANIFEST && !Vfs::get().saveManifest(FileSystem::getPath(RESOURCE_MANIFEST)))
+        std::cout << "Failed to write resource manifest " << RESOURCE_MANIFEST << std::endl;
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -883,7 +1019,7 @@ int main() {
 // -------------------------------------------------
 unsigned int cubeVAO1 = 0;
 unsigned int cubeVBO1 = 0;
-void renderCube()
+unsigned int cubeVertexArray()
 {
     // initialize (if necessary)
     if (cubeVAO1 == 0)
@@ -938,7 +1074,7 @@ void renderCube()
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO1);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
         // link vertex attributes
-        glBindVertexArray(cubeVAO1);
+        GLState::get().bindVertexArray(cubeVAO1);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(1);
@@ -946,12 +1082,15 @@ void renderCube()
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
     }
+    return cubeVAO1;
+}
+
+void renderCube()
+{
     // render Cube
-    glBindVertexArray(cubeVAO1);
+    GLState::get().bindVertexArray(cubeVertexArray());
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
 }
 
 
@@ -974,7 +1113,7 @@ void renderQuad1()
         // setup plane VAO
         glGenVertexArrays(1, &quadVAO1);
         glGenBuffers(1, &quadVBO1);
-        glBindVertexArray(quadVAO1);
+        GLState::get().bindVertexArray(quadVAO1);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO1);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -982,15 +1121,14 @@ void renderQuad1()
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO1);
+    GLState::get().bindVertexArray(quadVAO1);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
 }
 
 
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
-void renderQuad()
+unsigned int quadVertexArray()
 {
     if (quadVAO == 0)
     {
@@ -1059,7 +1197,7 @@ void renderQuad()
         // configure plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        GLState::get().bindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -1073,9 +1211,13 @@ void renderQuad()
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(11 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
+    return quadVAO;
+}
+
+void renderQuad()
+{
+    GLState::get().bindVertexArray(quadVertexArray());
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -1230,34 +1372,42 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Render queue");
+        const RenderQueueStats& s = renderQueueStats;
+        ImGui::Text("Packets: %zu, draw calls: %zu", s.packets, s.drawCalls);
+        ImGui::Text("State changes: %zu (unsorted: %zu)", s.stateChanges, s.unsortedStateChanges);
+        ImGui::Text("Program: %zu, VAO: %zu, material: %zu, render state: %zu", s.programChanges, s.vaoChanges, s.materialChanges,
+                    s.renderStateChanges);
+        ImGui::Text("Texture binds: %zu", s.textureBinds);
+        ImGui::Text("Sort: %.3f ms, submit: %.3f ms", s.sortMs, s.submitMs);
+        ImGui::Separator();
+        ImGui::Text("GL state calls: %zu issued, %zu filtered", glStateStats.totalIssued(), glStateStats.totalFiltered());
+        for (int call = 0; call < GL_STATE_CALL_COUNT; call++)
+            ImGui::Text("  %s: %zu / %zu", GLStateStats::name((GLStateCall)call), glStateStats.issued[call], glStateStats.filtered[call]);
+        ImGui::End();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 
-void set_spotLight(Shader& shader){
-    shader.setVec3("spotLight.position",programState->camera.Position);
-    shader.setVec3("spotLight.direction",programState->camera.Front);
+SpotLight get_spotLight(){
+    SpotLight spotLight;
+    spotLight.position = programState->camera.Position;
+    spotLight.direction = programState->camera.Front;
+    spotLight.cutOff = glm::cos(glm::radians(3.0f));
+    spotLight.outerCutOff = glm::cos(glm::radians(21.0f));
 
-    if(spotLightActivated){
-        shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-        shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-    }
-    else{
-        shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        shader.setVec3("spotLight.diffuse", 0.0f, 0.0f, 0.0f);
-        shader.setVec3("spotLight.specular", 0.0f, 0.0f, 0.0f);
-    }
-    shader.setFloat("spotLight.constant", 1.0f);
-    shader.setFloat("spotLight.linear", 0.07);
-    shader.setFloat("spotLight.quadratic", 0.001);
-    shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(3.0f)));
-    shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(21.0f)));
-
-    shader.setVec3("viewPos",programState->camera.Position);
-    shader.setFloat("material.shininess", 32.0f);
+    spotLight.constant = 1.0f;
+    spotLight.linear = 0.07f;
+    spotLight.quadratic = 0.001f;
 
+    spotLight.ambient = glm::vec3(0.0f);
+    spotLight.diffuse = spotLightActivated ? glm::vec3(1.0f) : glm::vec3(0.0f);
+    spotLight.specular = spotLight.diffuse;
+    return spotLight;
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
@@ -1304,70 +1454,15 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 }
 
 
-unsigned int loadTexture(char const * path)
+TextureHandle loadTexture(char const * path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    ScopedTimer timer("texture load", Vfs::get().relativeName(path));
+    return TextureRegistry::get().acquire(path);
 }
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+    ScopedTimer timer("cubemap load", faces.empty() ? "" : Vfs::get().relativeName(faces[0]));
+    return TextureLoader::get().loadCubemap(faces);
 }
 
@@ -0,0 +1,123 @@
+// Offline texture bake: encodes source images into block compressed KTX files with a full mip chain.
+//
+//   bake_textures [image ...]
+//
+// Without arguments every .jpg/.png in resources/textures is baked. Normal maps (*_nor*, *normal*) become
+// BC5, height/displacement maps (*disp*, *height*) BC4, images with an alpha channel BC3 and the rest BC1.
+// BC5 drops z, only the normal and parallax mapping shaders rebuild it; normal maps of models (under
+// resources/objects, bound to the model shaders as plain RGB) keep z and are baked like colour images.
+// loadTexture/TextureFromFile pick up the .ktx file automatically when it is not older than its source.
+#include <stb_image.h>
+
+#include <learnopengl/bc_encoder.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/thread_pool.h>
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static bool contains(std::string haystack, const std::string &needle)
+{
+    std::transform(haystack.begin(), haystack.end(), haystack.begin(), ::tolower);
+    return haystack.find(needle) != std::string::npos;
+}
+
+static bc::Format chooseFormat(const std::string &path, int components, const unsigned char *rgba, size_t texels)
+{
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    if ((contains(name, "_nor") || contains(name, "normal")) && !contains(path, "resources/objects/"))
+        return bc::BC5;
+    if (contains(name, "disp") || contains(name, "height") || components == 1)
+        return bc::BC4;
+    if (components == 4)
+        for (size_t i = 0; i < texels; i++)
+            if (rgba[i * 4 + 3] != 255)
+                return bc::BC3;
+    return bc::BC1;
+}
+
+static bool bake(const std::string &path)
+{
+    auto start = std::chrono::steady_clock::now();
+    int width, height, components;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 4);
+    if (!data)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return false;
+    }
+    bc::Format format = chooseFormat(path, components, data, (size_t)width * height);
+    std::vector<uint8_t> rgba(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    static const uint32_t internalFormats[] = {KTX_COMPRESSED_RGB_S3TC_DXT1, KTX_COMPRESSED_RGBA_S3TC_DXT5,
+                                               KTX_COMPRESSED_RED_RGTC1, KTX_COMPRESSED_RG_RGTC2};
+    static const uint32_t baseFormats[] = {0x1907 /* GL_RGB */, 0x1908 /* GL_RGBA */, 0x1903 /* GL_RED */, 0x8227 /* GL_RG */};
+    static const char *names[] = {"BC1", "BC3", "BC4", "BC5"};
+
+    std::vector<std::vector<uint8_t>> levels;
+    size_t uncompressed = 0, compressed = 0;
+    int w = width, h = height;
+    for (;;)
+    {
+        levels.push_back(std::vector<uint8_t>(bc::levelBytes(format, w, h)));
+        // rows of 4x4 blocks, a few per job so the pool's threads share a level evenly
+        size_t blockRows = (size_t)(h + 3) / 4;
+        size_t grain = std::max<size_t>(1, blockRows / (ThreadPool::shared().size() * 4));
+        ThreadPool::shared().parallelFor(blockRows, grain, [&](size_t first, size_t last) {
+            bc::encodeRows(rgba.data(), w, h, format, (int)first, (int)last, levels.back().data());
+        });
+        uncompressed += (size_t)w * h * components;
+        compressed += levels.back().size();
+        if (w == 1 && h == 1)
+            break;
+        rgba = bc::downsample(rgba, w, h, format == bc::BC5);
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    std::string bakedPath = bakedTexturePath(path);
+    if (!writeKtx(bakedPath, internalFormats[format], baseFormats[format], width, height, levels))
+    {
+        std::cout << "ERROR::BAKE:: could not write " << bakedPath << std::endl;
+        return false;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << path << " -> " << bakedPath << " (" << names[format] << ", " << levels.size() << " levels, "
+              << compressed / 1024 << " KB vs " << uncompressed / 1024 << " KB uncompressed, " << ms << " ms)" << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+        paths.push_back(argv[i]);
+
+    if (paths.empty())
+    {
+        const std::string directory = "resources/textures";
+        if (DIR *dir = opendir(directory.c_str()))
+        {
+            while (dirent *entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (contains(name, ".jpg") || contains(name, ".png"))
+                    paths.push_back(directory + "/" + name);
+            }
+            closedir(dir);
+        }
+        std::sort(paths.begin(), paths.end());
+    }
+
+    int failed = 0;
+    for (const std::string &path : paths)
+        if (!bake(path))
+            failed++;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Compares ObjLoader (obj_loader.h) with Assimp's OBJ importer on the same files.
+//
+//   bench_obj [model.obj ...]
+//
+// Without arguments the OBJ models of the scene are used. Both sides produce triangulated meshes with flipped
+// texture coordinates (aiProcess_Triangulate | aiProcess_FlipUVs) and no other post-processing, so the numbers
+// compare parsing alone. Reported per file: best time of a few runs for each side, the speedup and the mesh,
+// vertex and triangle counts of both, which should agree. Run from the project root.
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const int RUNS = 5;
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool bench(const std::string &path)
+{
+    double assimpMs = 1e30;
+    size_t assimpMeshes = 0, assimpVertices = 0, assimpTriangles = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        Assimp::Importer importer;
+        auto start = std::chrono::steady_clock::now();
+        const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+        assimpMs = std::min(assimpMs, msSince(start));
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            std::cout << path << ": " << importer.GetErrorString() << std::endl;
+            return false;
+        }
+        assimpMeshes = scene->mNumMeshes;
+        assimpVertices = assimpTriangles = 0;
+        for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+        {
+            assimpVertices += scene->mMeshes[m]->mNumVertices;
+            assimpTriangles += scene->mMeshes[m]->mNumFaces;
+        }
+    }
+
+    double nativeMs = 1e30;
+    size_t nativeVertices = 0, nativeTriangles = 0;
+    std::vector<ObjMesh> meshes;
+    for (int run = 0; run < RUNS; run++)
+    {
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        bool loaded = ObjLoader::load(path, meshes, error);
+        nativeMs = std::min(nativeMs, msSince(start));
+        if (!loaded)
+        {
+            std::cout << path << ": " << error << std::endl;
+            return false;
+        }
+    }
+    for (const ObjMesh &mesh : meshes)
+    {
+        nativeVertices += mesh.data.vertices.size();
+        nativeTriangles += mesh.data.indices.size() / 3;
+    }
+
+    std::cout << path << std::endl;
+    std::cout << "  assimp  " << assimpMs << " ms, " << assimpMeshes << " meshes, " << assimpVertices << " vertices, "
+              << assimpTriangles << " triangles" << std::endl;
+    std::cout << "  native  " << nativeMs << " ms, " << meshes.size() << " meshes, " << nativeVertices << " vertices, "
+              << nativeTriangles << " triangles (" << ThreadPool::shared().size() << " workers)" << std::endl;
+    std::cout << "  speedup " << (nativeMs > 0.0 ? assimpMs / nativeMs : 0.0) << "x" << std::endl;
+    // Assimp also counts points and lines as faces, and may split meshes differently
+    if (assimpTriangles != nativeTriangles)
+        std::cout << "  triangle counts differ" << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> paths(argv + 1, argv + argc);
+    if (paths.empty())
+        paths = {"resources/objects/LibertyStatue/LibertStatue.obj", "resources/objects/10421_square_pedastal_iterations-2.obj",
+                 "resources/objects/Wood Table with glasplatte/Wood_Table.obj"};
+
+    bool ok = true;
+    for (const std::string &path : paths)
+        ok = bench(path) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// Compares generateTangentSpace (tangent_space.h) with Assimp's aiProcess_GenSmoothNormals |
+// aiProcess_CalcTangentSpace on the same imported geometry: time taken and how far the results are apart.
+//
+//   bench_tangents [--force-normals] [--tolerance degrees] model ...
+//
+// Both sides start from an import with aiProcess_Triangulate | aiProcess_FlipUVs, like Model::import with
+// ModelOptions::nativeTangentSpace. Normals are only generated for meshes without them, unless --force-normals
+// (aiProcess_ForceGenNormals) regenerates them everywhere. Reported per model: milliseconds of each side (best of
+// a few runs) and the angle between the normals and tangents of each vertex, mean, largest and the share within
+// the tolerance (default 5 degrees). Bitangents are compared by handedness only.
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/tangent_space.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const int RUNS = 5;
+
+struct MeshInput {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    bool hasNormals;
+};
+
+struct AngleStats {
+    double sum = 0.0, max = 0.0;
+    size_t count = 0, within = 0;
+
+    void add(const glm::vec3 &a, const glm::vec3 &b, double tolerance)
+    {
+        float la = glm::length(a), lb = glm::length(b);
+        if (la <= 0.0f || lb <= 0.0f)
+            return;
+        double angle = std::acos(std::max(-1.0f, std::min(1.0f, glm::dot(a, b) / (la * lb)))) * 180.0 / 3.14159265358979;
+        sum += angle;
+        max = std::max(max, angle);
+        count++;
+        if (angle <= tolerance)
+            within++;
+    }
+};
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const aiScene *import(Assimp::Importer &importer, const std::string &path)
+{
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << path << ": " << importer.GetErrorString() << std::endl;
+        return nullptr;
+    }
+    return scene;
+}
+
+static std::vector<MeshInput> copyMeshes(const aiScene *scene)
+{
+    std::vector<MeshInput> meshes;
+    for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+    {
+        const aiMesh *mesh = scene->mMeshes[m];
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+            continue;
+        MeshInput input;
+        input.hasNormals = mesh->HasNormals();
+        input.vertices.resize(mesh->mNumVertices);
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            Vertex &vertex = input.vertices[i];
+            vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            vertex.Normal = input.hasNormals ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f);
+            vertex.TexCoords = mesh->mTextureCoords[0] ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) : glm::vec2(0.0f);
+        }
+        for (unsigned int f = 0; f < mesh->mNumFaces; f++)
+            for (unsigned int j = 0; j < mesh->mFaces[f].mNumIndices; j++)
+                input.indices.push_back(mesh->mFaces[f].mIndices[j]);
+        meshes.push_back(std::move(input));
+    }
+    return meshes;
+}
+
+static bool bench(const std::string &path, bool forceNormals, double tolerance)
+{
+    // Assimp: post-processing only, on a fresh import per run
+    double assimpMs = 1e30;
+    Assimp::Importer reference;
+    const aiScene *result = nullptr;
+    for (int run = 0; run < RUNS; run++)
+    {
+        if (!import(reference, path))
+            return false;
+        auto start = std::chrono::steady_clock::now();
+        result = reference.ApplyPostProcessing(aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
+                                               (forceNormals ? aiProcess_ForceGenNormals : 0));
+        assimpMs = std::min(assimpMs, msSince(start));
+    }
+    if (!result)
+    {
+        std::cout << path << ": " << reference.GetErrorString() << std::endl;
+        return false;
+    }
+
+    // in-house, from the same import
+    Assimp::Importer importer;
+    const aiScene *scene = import(importer, path);
+    if (!scene)
+        return false;
+    const std::vector<MeshInput> inputs = copyMeshes(scene);
+    std::vector<MeshInput> meshes;
+    double nativeMs = 1e30;
+    size_t vertexCount = 0, triangleCount = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        meshes = inputs;
+        auto start = std::chrono::steady_clock::now();
+        // the same split as Model::processMeshes: meshes in parallel, each one over triangle ranges
+        ThreadPool::shared().parallelFor(meshes.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t m = begin; m < end; m++)
+                generateTangentSpace(meshes[m].vertices, meshes[m].indices, forceNormals || !meshes[m].hasNormals);
+        });
+        nativeMs = std::min(nativeMs, msSince(start));
+    }
+
+    AngleStats normals, tangents;
+    size_t handednessMismatches = 0;
+    size_t input = 0;
+    for (unsigned int m = 0; m < result->mNumMeshes; m++)
+    {
+        const aiMesh *mesh = result->mMeshes[m];
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+            continue;
+        const std::vector<Vertex> &vertices = meshes[input++].vertices;
+        vertexCount += vertices.size();
+        triangleCount += mesh->mNumFaces;
+        for (unsigned int i = 0; i < mesh->mNumVertices && i < vertices.size(); i++)
+        {
+            glm::vec3 n(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            normals.add(vertices[i].Normal, n, tolerance);
+            if (!mesh->HasTangentsAndBitangents())
+                continue;
+            glm::vec3 t(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+            glm::vec3 b(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            tangents.add(vertices[i].Tangent, t, tolerance);
+            if (glm::dot(vertices[i].Bitangent, b) < 0.0f)
+                handednessMismatches++;
+        }
+    }
+
+    std::cout << path << ": " << meshes.size() << " meshes, " << vertexCount << " vertices, " << triangleCount << " triangles" << std::endl;
+    std::cout << "  assimp  " << assimpMs << " ms" << std::endl;
+    std::cout << "  native  " << nativeMs << " ms (" << ThreadPool::shared().size() << " workers), "
+              << (nativeMs > 0.0 ? assimpMs / nativeMs : 0.0) << "x" << std::endl;
+    AngleStats *stats[2] = {&normals, &tangents};
+    const char *names[2] = {"normals ", "tangents"};
+    for (int s = 0; s < 2; s++)
+        if (stats[s]->count)
+            std::cout << "  " << names[s] << " mean " << stats[s]->sum / stats[s]->count << " deg, max " << stats[s]->max
+                      << " deg, " << 100.0 * stats[s]->within / stats[s]->count << "% within " << tolerance << " deg" << std::endl;
+    std::cout << "  bitangent handedness differs at " << handednessMismatches << " vertices" << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool forceNormals = false;
+    double tolerance = 5.0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--force-normals")
+            forceNormals = true;
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = std::atof(argv[++i]);
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+    {
+        std::cout << "usage: bench_tangents [--force-normals] [--tolerance degrees] model ..." << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    for (const std::string &path : paths)
+        ok = bench(path, forceNormals, tolerance) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+// Packs the files a scene reads into one archive (resource_archive.h) that the Vfs maps at startup.
+//
+//   pack_resources [manifest [archive]]
+//
+// The manifest lists one path per line relative to the project root, as written by the program when
+// RECORD_RESOURCE_MANIFEST is set (default resources/scene.manifest). Run from the project root; the archive
+// defaults to resources/scene.pak. Files listed but missing on disk are skipped with a warning.
+#include <learnopengl/resource_archive.h>
+#include <learnopengl/vfs.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    std::string manifestPath = argc > 1 ? argv[1] : "resources/scene.manifest";
+    std::string archivePath = argc > 2 ? argv[2] : "resources/scene.pak";
+    auto start = std::chrono::steady_clock::now();
+
+    std::ifstream manifest(manifestPath);
+    if (!manifest)
+    {
+        std::cout << "Failed to open manifest " << manifestPath << std::endl;
+        return 1;
+    }
+
+    std::set<std::string> unique;
+    std::vector<std::string> names;
+    size_t bytes = 0;
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        std::string name = Vfs::normalize(line);
+        if (name.empty() || !unique.insert(name).second)
+            continue;
+        std::ifstream file(name, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            std::cout << "skipped " << name << " (not found)" << std::endl;
+            continue;
+        }
+        bytes += (size_t)file.tellg();
+        names.push_back(name);
+    }
+
+    if (!ResourceArchive::write(archivePath, names, names))
+    {
+        std::cout << "Failed to write " << archivePath << std::endl;
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Packed " << names.size() << " files (" << bytes / 1024 << " KiB) into " << archivePath
+              << " in " << ms << " ms" << std::endl;
+    return 0;
+}